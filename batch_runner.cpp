@@ -0,0 +1,256 @@
+#include "batch_runner.h"
+#include "kernel_cache.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <new>
+#include <poll.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <system_error>
+#include <thread>
+#include <unistd.h>
+
+namespace cinolib {
+
+// exit codes of a worker whose job ran out of memory, failed on a system
+// call, or threw any other exception
+static const int EXIT_OUT_OF_MEMORY = 99;
+static const int EXIT_SYSTEM_ERROR = 98;
+static const int EXIT_EXCEPTION = 97;
+
+CINO_INLINE
+std::vector<std::string> shard_inputs(const std::vector<std::string> &inputs,
+                                      const uint shard, const uint num_shards) {
+  std::vector<std::string> selected;
+  for (const std::string &input : inputs) {
+    // the file name, or the entry name for archive entries
+    std::string name = input.substr(input.find_last_of("/:") + 1);
+    StreamHash h;
+    h.update(name.data(), name.size());
+    if (std::stoull(h.digest().substr(0, 16), nullptr, 16) % num_shards ==
+        shard)
+      selected.push_back(input);
+  }
+  return selected;
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+// runs job on input in a new process, whose output (the CSV fields) comes
+// back on the returned pipe. Returns the pid, or -1 if the fork failed
+CINO_INLINE
+static pid_t spawn_worker(const std::string &input, const RunnerLimits &limits,
+                          const RunnerJob &job, int &fd) {
+  int p[2];
+  if (pipe(p) != 0)
+    return -1;
+  pid_t pid = fork();
+  if (pid != 0) {
+    close(p[1]);
+    fd = p[0];
+    if (pid < 0)
+      close(p[0]);
+    return pid;
+  }
+  close(p[0]);
+  if (limits.memory_limit > 0) {
+    rlimit r = {limits.memory_limit, limits.memory_limit};
+    setrlimit(RLIMIT_AS, &r);
+  }
+  if (limits.time_limit > 0) {
+    // backstop for the parent's kill, should the parent die. The job may run
+    // on one thread per core (parallel_chunks), which uses CPU time that many
+    // times faster than wall time
+    uint threads = std::max(1u, std::thread::hardware_concurrency());
+    rlim_t s = std::ceil(limits.time_limit * threads) + 1;
+    rlimit r = {s, s + 1};
+    setrlimit(RLIMIT_CPU, &r);
+  }
+  // the kernel code logs on stdout, which carries the parent's results
+  int null_fd = open("/dev/null", O_WRONLY);
+  if (null_fd >= 0)
+    dup2(null_fd, STDOUT_FILENO);
+  std::string fields;
+  try {
+    fields = job(input);
+  } catch (const std::bad_alloc &) {
+    _exit(EXIT_OUT_OF_MEMORY);
+  } catch (const std::system_error &e) {
+    // a thread whose stack does not fit in the address space limit fails
+    // with EAGAIN, an allocation by the system with ENOMEM
+    std::cerr << input << ": " << e.what() << std::endl;
+    if (e.code() == std::errc::resource_unavailable_try_again ||
+        e.code() == std::errc::not_enough_memory)
+      _exit(EXIT_OUT_OF_MEMORY);
+    _exit(EXIT_SYSTEM_ERROR);
+  } catch (const std::exception &e) {
+    std::cerr << input << ": " << e.what() << std::endl;
+    _exit(EXIT_EXCEPTION);
+  } catch (...) {
+    _exit(EXIT_EXCEPTION);
+  }
+  std::cout.flush();
+  for (size_t done = 0; done < fields.size();) {
+    ssize_t n = write(p[1], fields.data() + done, fields.size() - done);
+    if (n <= 0)
+      _exit(1);
+    done += n;
+  }
+  _exit(0); // no destructors or atexit handlers of the parent's state
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+CINO_INLINE
+uint run_workers(const std::vector<std::string> &inputs,
+                 const RunnerLimits &limits, const RunnerJob &job,
+                 const uint num_fields, std::ostream &out) {
+  using Clock = std::chrono::steady_clock;
+  struct Worker {
+    pid_t pid;
+    int fd;
+    uint index; // of the input
+    Clock::time_point deadline;
+    std::string fields;
+  };
+  std::vector<Worker> running;
+  std::vector<std::string> lines(inputs.size());
+  std::vector<bool> done(inputs.size(), false);
+  uint next = 0, printed = 0, failed = 0;
+
+  // collects the exit status of a worker whose pipe is closed
+  auto finish = [&](const Worker &w, const bool timed_out) {
+    int status = 0;
+    waitpid(w.pid, &status, 0);
+    close(w.fd);
+    std::string result;
+    if (timed_out ||
+        (WIFSIGNALED(status) && WTERMSIG(status) == SIGXCPU))
+      result = "timeout";
+    else if (WIFSIGNALED(status))
+      result = "crash_" + std::to_string(WTERMSIG(status));
+    else if (WEXITSTATUS(status) == EXIT_OUT_OF_MEMORY)
+      result = "out_of_memory";
+    else if (WEXITSTATUS(status) == EXIT_SYSTEM_ERROR)
+      result = "error_system";
+    else if (WEXITSTATUS(status) == EXIT_EXCEPTION)
+      result = "error_exception";
+    else if (WEXITSTATUS(status) != 0)
+      result = "error_" + std::to_string(WEXITSTATUS(status));
+    if (result.empty())
+      result = "ok," + w.fields;
+    else {
+      failed++;
+      result += std::string(num_fields, ',');
+    }
+    lines.at(w.index) = inputs.at(w.index) + "," + result;
+    done.at(w.index) = true;
+  };
+
+  while (printed < inputs.size()) {
+    while (running.size() < std::max(1u, limits.workers) &&
+           next < inputs.size()) {
+      out.flush(); // or the worker would write the pending output again
+      Worker w;
+      w.index = next++;
+      w.deadline = Clock::now() + std::chrono::microseconds(
+                                      (long long)(limits.time_limit * 1e6));
+      w.pid = spawn_worker(inputs.at(w.index), limits, job, w.fd);
+      if (w.pid < 0) {
+        failed++;
+        lines.at(w.index) = inputs.at(w.index) + ",error_fork" +
+                            std::string(num_fields, ',');
+        done.at(w.index) = true;
+      } else
+        running.push_back(w);
+    }
+
+    // waits for output, the end of a worker or its deadline
+    if (!running.empty()) {
+      int timeout = -1;
+      if (limits.time_limit > 0) {
+        Clock::time_point first = running.front().deadline;
+        for (const Worker &w : running)
+          first = std::min(first, w.deadline);
+        timeout = std::max<long long>(
+            0, std::chrono::duration_cast<std::chrono::milliseconds>(
+                   first - Clock::now())
+                       .count() +
+                   1);
+      }
+      std::vector<pollfd> fds(running.size());
+      for (uint i = 0; i < running.size(); i++)
+        fds.at(i) = {running.at(i).fd, POLLIN, 0};
+      poll(fds.data(), fds.size(), timeout);
+      Clock::time_point now = Clock::now();
+      for (uint i = running.size(); i-- > 0;) {
+        Worker &w = running.at(i);
+        bool closed = false;
+        if (fds.at(i).revents != 0) {
+          char buf[4096];
+          ssize_t n = read(w.fd, buf, sizeof(buf));
+          if (n > 0)
+            w.fields.append(buf, n);
+          else
+            closed = true;
+        }
+        bool timed_out =
+            !closed && limits.time_limit > 0 && now >= w.deadline;
+        if (timed_out)
+          kill(w.pid, SIGKILL);
+        if (closed || timed_out) {
+          finish(w, timed_out);
+          running.erase(running.begin() + i);
+        }
+      }
+    }
+
+    for (; printed < inputs.size() && done.at(printed); printed++)
+      out << lines.at(printed) << "\n";
+    out.flush();
+  }
+  return failed;
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+CINO_INLINE
+bool merge_results(const std::vector<std::string> &paths, std::ostream &out) {
+  std::string header;
+  std::vector<std::string> lines;
+  for (const std::string &path : paths) {
+    std::ifstream in(path);
+    std::string h, line;
+    if (!std::getline(in, h)) {
+      std::cerr << "Cannot read " << path << std::endl;
+      return false;
+    }
+    if (!header.empty() && h != header) {
+      std::cerr << "Different header in " << path << std::endl;
+      return false;
+    }
+    header = h;
+    while (std::getline(in, line))
+      if (!line.empty())
+        lines.push_back(line);
+  }
+  auto key = [](const std::string &line) {
+    return line.substr(0, line.find(','));
+  };
+  std::stable_sort(lines.begin(), lines.end(),
+                   [&](const std::string &a, const std::string &b) {
+                     return key(a) < key(b);
+                   });
+  out << header << "\n";
+  for (const std::string &line : lines)
+    out << line << "\n";
+  out.flush();
+  return true;
+}
+
+} // namespace cinolib
@@ -0,0 +1,67 @@
+#ifndef BATCH_RUNNER_H
+#define BATCH_RUNNER_H
+
+// batch runs for large sweeps. Each mesh is processed in its own worker
+// process, forked with limits on its wall time and address space, so that a
+// mesh that hangs, runs out of memory or crashes only costs its own result,
+// which records what happened. Several workers run at a time.
+//
+// A sweep can also be split in shards, run by independent invocations (e.g.
+// on different machines, each with a local copy of the data): the shard of a
+// mesh depends only on its file name, not on where it is stored or on the
+// order of the input list. The per-shard CSV files are then merged into one.
+
+#include <cinolib/cino_inline.h>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace cinolib {
+
+struct RunnerLimits {
+  uint workers = 1;          // concurrent worker processes
+  double time_limit = 0;     // wall time per mesh, in seconds (0: none)
+  uint64_t memory_limit = 0; // address space per mesh, in bytes (0: none)
+};
+
+// The memory limit is on address space (RLIMIT_AS), not on resident memory:
+// it also counts the stacks of the threads a job starts (the ChunkPool of
+// parallel_chunks.h, compute_race), reserved whether used or not, so it must
+// leave room for them on top of the heap.
+
+// the inputs that belong to shard (in [0, num_shards)), in their original
+// order
+CINO_INLINE
+std::vector<std::string> shard_inputs(const std::vector<std::string> &inputs,
+                                      const uint shard, const uint num_shards);
+
+// computes the result of an input, as CSV fields; called in the worker
+typedef std::function<std::string(const std::string &input)> RunnerJob;
+
+// runs job on each input in a worker process and writes one CSV line per
+// input, in input order:
+//   <input>,<status>,<fields>
+// where status is ok, timeout, out_of_memory (std::bad_alloc, or a thread
+// that could not be started), error_system (any other std::system_error),
+// error_exception (any other exception), crash_<signal> or error_<exit code>.
+// Failed inputs get num_fields empty fields. Returns the number of inputs
+// whose status is not ok
+CINO_INLINE
+uint run_workers(const std::vector<std::string> &inputs,
+                 const RunnerLimits &limits, const RunnerJob &job,
+                 const uint num_fields, std::ostream &out);
+
+// merges the CSV files written by the shards of a sweep into out: the header
+// once, then the lines of all files sorted by their first field. Returns false
+// if a file cannot be read or the headers differ
+CINO_INLINE
+bool merge_results(const std::vector<std::string> &paths, std::ostream &out);
+
+} // namespace cinolib
+
+#ifndef CINO_STATIC_LIB
+#include "batch_runner.cpp"
+#endif
+
+#endif // BATCH_RUNNER_H
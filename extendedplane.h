@@ -10,42 +10,59 @@
 
 namespace cinolib {
 
+// tolerances for each scalar type
+template <class T> struct ScalarTolerance;
+
+template <> struct ScalarTolerance<double> {
+  static constexpr double plane = 1e-10; // plane construction checks
+  static constexpr double kernel = 1e-8; // kernel classification
+};
+
+template <> struct ScalarTolerance<float> {
+  static constexpr float plane = 1e-4f;
+  static constexpr float kernel = 1e-4f;
+};
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
 // represents a plane with equation
 // a*x + b*y + c*z = d
 // or, using the Hessian Normal Form
 // (https://en.wikipedia.org/wiki/Hesse_normal_form) n dot (x,y,z) - d = 0
 
-class ExtendedPlane {
+template <class T = double> class ExtendedPlane {
 
 public:
-  vec3d n;  // plane normal (i.e. a,b,c, coefficients of the plane equation)
-  double d; // d coefficient of the plane equation
-  vec3d p;  // any point on the plane (useful for point_plane_dist)
-  std::vector<vec3d> points; // three points on the plane (the first one is p)
+  typedef mat<3, 1, T> vec;
+
+  vec n; // plane normal (i.e. a,b,c, coefficients of the plane equation)
+  T d;   // d coefficient of the plane equation
+  vec p; // any point on the plane (useful for point_plane_dist)
+  std::vector<vec> points; // three points on the plane (the first one is p)
 
   //::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
 
-  explicit ExtendedPlane(const vec3d &point = vec3d(0, 0, 0),
-                         const vec3d &normal = vec3d(0, 0, 1));
+  explicit ExtendedPlane(const vec &point = vec(0, 0, 0),
+                         const vec &normal = vec(0, 0, 1));
 
-  explicit ExtendedPlane(const vec3d &p0, const vec3d &p1, const vec3d &p2);
+  explicit ExtendedPlane(const vec &p0, const vec &p1, const vec &p2);
 
   explicit ExtendedPlane(
-      const std::vector<vec3d> &samples); // best fitting plane
+      const std::vector<vec> &samples); // best fitting plane
 
   //::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
 
-  double a() const { return n.x(); }
-  double b() const { return n.y(); }
-  double c() const { return n.z(); }
+  T a() const { return n.x(); }
+  T b() const { return n.y(); }
+  T c() const { return n.z(); }
 
   //::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
 
-  void set_plane(const vec3d &point, const vec3d &normal);
+  void set_plane(const vec &point, const vec &normal);
 
   //::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
 
-  double operator[](const vec3d &p) const;
+  T operator[](const vec &p) const;
 
   //::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
 
@@ -53,15 +70,16 @@ public:
 
   //::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
 
-  double point_plane_dist_signed(const vec3d &p) const;
-  double point_plane_dist(const vec3d &p) const;
-  vec3d project_onto(const vec3d &p) const;
+  T point_plane_dist_signed(const vec &p) const;
+  T point_plane_dist(const vec &p) const;
+  vec project_onto(const vec &p) const;
 };
 
 //::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
 
-CINO_INLINE
-std::ostream &operator<<(std::ostream &in, const ExtendedPlane &plane);
+template <class T>
+CINO_INLINE std::ostream &operator<<(std::ostream &in,
+                                     const ExtendedPlane<T> &plane);
 
 } // namespace cinolib
 
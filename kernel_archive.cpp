@@ -0,0 +1,322 @@
+#include "kernel_archive.h"
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <fcntl.h>
+#include <iostream>
+#include <unistd.h>
+#ifdef KERNEL_HAS_ZLIB
+#include <zlib.h>
+#endif
+
+namespace cinolib {
+
+static const uint32_t ZIP_LOCAL_HEADER = 0x04034b50;
+static const uint32_t ZIP_DIRECTORY_ENTRY = 0x02014b50;
+static const uint32_t ZIP_END = 0x06054b50;
+static const uint32_t ZIP64_END = 0x06064b50;
+static const uint32_t ZIP64_LOCATOR = 0x07064b50;
+
+// size of a central directory entry without its variable fields
+static const uint ZIP_DIRECTORY_ENTRY_SIZE = 46;
+
+// deflate expands its input at most 1032 times (258 bytes per 2 bit code)
+static const uint64_t DEFLATE_MAX_RATIO = 1032;
+
+// little endian integer of n bytes at p
+CINO_INLINE
+static uint64_t read_le(const unsigned char *p, const uint n) {
+  uint64_t x = 0;
+  for (uint i = n; i-- > 0;)
+    x = (x << 8) | p[i];
+  return x;
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+// CRC-32 of the size bytes at data, as stored in zip entries
+CINO_INLINE
+static uint32_t archive_crc32(const unsigned char *data, const uint64_t size) {
+#ifdef KERNEL_HAS_ZLIB
+  // zlib's crc32 takes uInt sizes, hence the chunks
+  uLong crc = crc32(0L, Z_NULL, 0);
+  for (uint64_t i = 0; i < size; i += 1u << 30)
+    crc = crc32(crc, data + i, std::min<uint64_t>(size - i, 1u << 30));
+  return crc;
+#else
+  // byte at a time over a table of the reflected polynomial 0xedb88320
+  static const std::array<uint32_t, 256> table = []() {
+    std::array<uint32_t, 256> t;
+    for (uint32_t i = 0; i < 256; i++) {
+      uint32_t c = i;
+      for (uint k = 0; k < 8; k++)
+        c = (c & 1) ? 0xedb88320 ^ (c >> 1) : c >> 1;
+      t.at(i) = c;
+    }
+    return t;
+  }();
+  uint32_t crc = 0xffffffff;
+  for (uint64_t i = 0; i < size; i++)
+    crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+  return ~crc;
+#endif
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+CINO_INLINE
+static bool ends_with(const std::string &s, const std::string &suffix) {
+  if (s.size() < suffix.size())
+    return false;
+  return std::equal(suffix.begin(), suffix.end(), s.end() - suffix.size(),
+                    [](char a, char b) {
+                      return std::tolower((unsigned char)a) ==
+                             std::tolower((unsigned char)b);
+                    });
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+CINO_INLINE
+bool split_archive_path(const std::string &path, std::string &archive,
+                        std::string &entry) {
+  for (size_t i = path.find(':'); i != std::string::npos;
+       i = path.find(':', i + 1))
+    if (ends_with(path.substr(0, i), ".zip")) {
+      archive = path.substr(0, i);
+      entry = path.substr(i + 1);
+      return true;
+    }
+  return false;
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+CINO_INLINE
+std::vector<std::string>
+expand_archive_inputs(const std::vector<std::string> &inputs) {
+  std::vector<std::string> expanded;
+  for (const std::string &input : inputs) {
+    if (!ends_with(input, ".zip")) {
+      expanded.push_back(input);
+      continue;
+    }
+    ZipArchive archive(input);
+    if (!archive.ok()) {
+      std::cerr << "Cannot read the archive " << input << std::endl;
+      continue;
+    }
+    for (const ArchiveEntry &e : archive.entries())
+      if (ends_with(e.name, ".off"))
+        expanded.push_back(input + ":" + e.name);
+  }
+  return expanded;
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+CINO_INLINE
+ZipArchive::ZipArchive(const std::string &path) : archive_path(path) {
+  fd = open(path.c_str(), O_RDONLY);
+  if (fd >= 0 && !read_directory()) {
+    close(fd);
+    fd = -1;
+    entry_list.clear();
+    entry_ids.clear();
+  }
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+CINO_INLINE
+ZipArchive::~ZipArchive() {
+  if (fd >= 0)
+    close(fd);
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+CINO_INLINE
+int ZipArchive::find(const std::string &name) const {
+  auto it = entry_ids.find(name);
+  return it == entry_ids.end() ? -1 : int(it->second);
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+CINO_INLINE
+bool ZipArchive::read_at(const uint64_t offset, void *data,
+                         const size_t size) const {
+  // pread keeps no file position, so entries can be read from any thread
+  size_t done = 0;
+  while (done < size) {
+    ssize_t n = pread(fd, (char *)data + done, size - done, offset + done);
+    if (n <= 0)
+      return false;
+    done += n;
+  }
+  return true;
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+CINO_INLINE
+bool ZipArchive::read_directory() {
+  // the end of central directory record is in the last 64 KB + 22 bytes (its
+  // comment is at most 64 KB long)
+  off_t file_size = lseek(fd, 0, SEEK_END);
+  if (file_size < 22)
+    return false;
+  archive_size = file_size;
+  size_t tail_size = std::min<off_t>(file_size, 65535 + 22);
+  std::vector<unsigned char> tail(tail_size);
+  if (!read_at(file_size - tail_size, tail.data(), tail_size))
+    return false;
+  size_t end = tail_size - 22 + 1;
+  while (end-- > 0 && read_le(&tail.at(end), 4) != ZIP_END)
+    ;
+  if (end == size_t(-1))
+    return false;
+  uint64_t num_entries = read_le(&tail.at(end + 10), 2);
+  uint64_t dir_size = read_le(&tail.at(end + 12), 4);
+  uint64_t dir_offset = read_le(&tail.at(end + 16), 4);
+  if (end >= 20 && read_le(&tail.at(end - 20), 4) == ZIP64_LOCATOR) {
+    unsigned char z[56];
+    if (!read_at(read_le(&tail.at(end - 20 + 8), 8), z, 56) ||
+        read_le(z, 4) != ZIP64_END)
+      return false;
+    num_entries = read_le(z + 32, 8);
+    dir_size = read_le(z + 40, 8);
+    dir_offset = read_le(z + 48, 8);
+  }
+
+  // sizes come from the file, so they are checked against it before
+  // anything is allocated for them
+  if (dir_size > archive_size || dir_offset > archive_size - dir_size ||
+      num_entries > dir_size / ZIP_DIRECTORY_ENTRY_SIZE)
+    return false;
+  std::vector<unsigned char> dir(dir_size);
+  if (!read_at(dir_offset, dir.data(), dir_size))
+    return false;
+  entry_list.resize(num_entries);
+  size_t pos = 0;
+  for (uint eid = 0; eid < entry_list.size(); eid++) {
+    ArchiveEntry &e = entry_list.at(eid);
+    if (pos + ZIP_DIRECTORY_ENTRY_SIZE > dir_size ||
+        read_le(&dir.at(pos), 4) != ZIP_DIRECTORY_ENTRY)
+      return false;
+    const unsigned char *h = &dir.at(pos);
+    e.method = read_le(h + 10, 2);
+    e.crc = read_le(h + 16, 4);
+    e.packed_size = read_le(h + 20, 4);
+    e.size = read_le(h + 24, 4);
+    e.offset = read_le(h + 42, 4);
+    size_t name_size = read_le(h + 28, 2), extra_size = read_le(h + 30, 2);
+    size_t next = pos + ZIP_DIRECTORY_ENTRY_SIZE + name_size + extra_size +
+                  read_le(h + 32, 2);
+    if (next > dir_size)
+      return false;
+    e.name.assign((const char *)h + ZIP_DIRECTORY_ENTRY_SIZE, name_size);
+    // zip64 extended information: 64 bit values of the saturated fields
+    const unsigned char *x = h + ZIP_DIRECTORY_ENTRY_SIZE + name_size;
+    for (const unsigned char *x_end = x + extra_size; x + 4 <= x_end;) {
+      uint id = read_le(x, 2), size = read_le(x + 2, 2);
+      if (id == 1) {
+        const unsigned char *v = x + 4, *v_end = x + 4 + size;
+        for (uint64_t *field : {&e.size, &e.packed_size, &e.offset})
+          if (*field == 0xffffffff && v + 8 <= v_end) {
+            *field = read_le(v, 8);
+            v += 8;
+          }
+      }
+      x += 4 + size;
+    }
+    entry_ids.emplace(e.name, eid); // the first of duplicates
+    pos = next;
+  }
+  return true;
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+CINO_INLINE
+bool ZipArchive::read(const uint eid, std::string &out,
+                      std::string &error) const {
+  const ArchiveEntry &e = entry_list.at(eid);
+  unsigned char h[30];
+  if (!read_at(e.offset, h, 30) || read_le(h, 4) != ZIP_LOCAL_HEADER) {
+    error = "bad local header";
+    return false;
+  }
+  if (read_le(h + 6, 2) & 1) {
+    error = "encrypted entry";
+    return false;
+  }
+  // name and extra field may differ from those in the central directory
+  uint64_t data = e.offset + 30 + read_le(h + 26, 2) + read_le(h + 28, 2);
+  // e.offset was read above, so data is within a few KB of the file
+  if (e.packed_size > archive_size || data > archive_size - e.packed_size) {
+    error = "truncated entry";
+    return false;
+  }
+  if ((e.method == 0 && e.size != e.packed_size) ||
+      (e.method == 8 && e.size > e.packed_size * DEFLATE_MAX_RATIO)) {
+    error = "corrupt entry sizes";
+    return false;
+  }
+  out.resize(e.size);
+  if (e.method == 0) {
+    if (!read_at(data, &out[0], e.size)) {
+      error = "truncated entry";
+      return false;
+    }
+  } else if (e.method == 8) {
+#ifdef KERNEL_HAS_ZLIB
+    std::vector<unsigned char> packed(e.packed_size);
+    if (!read_at(data, packed.data(), packed.size())) {
+      error = "truncated entry";
+      return false;
+    }
+    z_stream z = {};
+    if (inflateInit2(&z, -MAX_WBITS) != Z_OK) { // raw deflate stream
+      error = "inflate failed";
+      return false;
+    }
+    // both sizes are known, so a single call inflates the whole entry.
+    // zlib counts in uInt, hence the chunks for entries above 4 GB
+    z.next_in = packed.data();
+    z.next_out = (unsigned char *)&out[0];
+    int status = Z_OK;
+    uint64_t in_left = packed.size(), out_left = e.size;
+    while (status == Z_OK) {
+      uInt in_chunk = std::min<uint64_t>(in_left, 1u << 30);
+      uInt out_chunk = std::min<uint64_t>(out_left, 1u << 30);
+      z.avail_in = in_chunk;
+      z.avail_out = out_chunk;
+      status = inflate(&z, Z_NO_FLUSH);
+      in_left -= in_chunk - z.avail_in;
+      out_left -= out_chunk - z.avail_out;
+      if (status == Z_BUF_ERROR && in_left > 0 && out_left > 0)
+        status = Z_OK; // the chunk was exhausted, not the stream
+    }
+    inflateEnd(&z);
+    if (status != Z_STREAM_END || out_left != 0) {
+      error = "corrupt deflate stream";
+      return false;
+    }
+#else
+    error = "deflated entry, built without zlib";
+    return false;
+#endif
+  } else {
+    error = "unsupported compression method " + std::to_string(e.method);
+    return false;
+  }
+  if (archive_crc32((const unsigned char *)out.data(), e.size) != e.crc) {
+    error = "CRC mismatch";
+    return false;
+  }
+  return true;
+}
+
+} // namespace cinolib
@@ -0,0 +1,97 @@
+#ifndef KERNEL_ARCHIVE_H
+#define KERNEL_ARCHIVE_H
+
+// read-only access to the meshes in zip archives (such as the bundled
+// datasets), without extracting them to disk. An input path of the form
+//   archive.zip:path/in/archive.off
+// names an entry of an archive, and a path ending in .zip stands for all the
+// OFF entries it contains. Entries are inflated into memory, with zlib when
+// available (KERNEL_HAS_ZLIB); without it only stored entries can be read.
+// Every entry is checked against its CRC-32, and the sizes recorded in the
+// archive against the size of the file, so that a corrupt archive gives an
+// error rather than a huge allocation. Zip64 archives are supported,
+// encrypted and multi-volume ones are not.
+
+#include <cinolib/cino_inline.h>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace cinolib {
+
+struct ArchiveEntry {
+  std::string name;         // full path in the archive
+  uint16_t method = 0;      // 0: stored, 8: deflated
+  uint32_t crc = 0;         // CRC-32 of the uncompressed data
+  uint64_t packed_size = 0; // compressed size
+  uint64_t size = 0;        // uncompressed size
+  uint64_t offset = 0;      // of the local header
+};
+
+// splits path into archive and entry if it has the form archive.zip:entry.
+// Returns false for plain paths
+CINO_INLINE
+bool split_archive_path(const std::string &path, std::string &archive,
+                        std::string &entry);
+
+// replaces each input ending in .zip with the archive paths of its OFF
+// entries, in archive order. Other inputs are kept as they are
+CINO_INLINE
+std::vector<std::string>
+expand_archive_inputs(const std::vector<std::string> &inputs);
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+class ZipArchive {
+
+public:
+  // opens path and reads its central directory
+  CINO_INLINE
+  explicit ZipArchive(const std::string &path);
+
+  CINO_INLINE
+  ~ZipArchive();
+
+  ZipArchive(const ZipArchive &) = delete;
+  ZipArchive &operator=(const ZipArchive &) = delete;
+
+  // false if the file could not be opened or is not a zip archive
+  CINO_INLINE
+  bool ok() const { return fd >= 0; }
+
+  const std::string &path() const { return archive_path; }
+
+  const std::vector<ArchiveEntry> &entries() const { return entry_list; }
+
+  // index of the entry named name, -1 if there is none
+  CINO_INLINE
+  int find(const std::string &name) const;
+
+  // inflates entry eid into out, whose c_str() can be parsed in place.
+  // Returns false (with a message in error) if the entry cannot be read,
+  // uses an unsupported method or fails its CRC check
+  CINO_INLINE
+  bool read(const uint eid, std::string &out, std::string &error) const;
+
+private:
+  int fd = -1;
+  std::string archive_path;
+  uint64_t archive_size = 0; // in bytes, bounds the sizes read from the file
+  std::vector<ArchiveEntry> entry_list;
+  std::unordered_map<std::string, uint> entry_ids; // by name
+
+  CINO_INLINE
+  bool read_directory();
+
+  CINO_INLINE
+  bool read_at(const uint64_t offset, void *data, const size_t size) const;
+};
+
+} // namespace cinolib
+
+#ifndef CINO_STATIC_LIB
+#include "kernel_archive.cpp"
+#endif
+
+#endif // KERNEL_ARCHIVE_H
@@ -0,0 +1,305 @@
+#include "kernel_cache.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <unistd.h>
+
+namespace cinolib {
+
+namespace fs = std::filesystem;
+
+static const uint64_t HASH_P1 = 0x9E3779B185EBCA87ULL;
+static const uint64_t HASH_P2 = 0xC2B2AE3D27D4EB4FULL;
+static const uint64_t HASH_P3 = 0x165667B19E3779F9ULL;
+static const uint64_t HASH_P4 = 0x85EBCA77C2B2AE63ULL;
+static const uint64_t HASH_P5 = 0x27D4EB2F165667C5ULL;
+
+static const char CACHE_MAGIC[4] = {'P', 'K', 'C', '1'};
+
+CINO_INLINE
+static uint64_t rotl(const uint64_t x, const int r) {
+  return (x << r) | (x >> (64 - r));
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+CINO_INLINE
+StreamHash::StreamHash(const uint64_t seed) {
+  acc[0] = seed + HASH_P1 + HASH_P2;
+  acc[1] = seed + HASH_P2;
+  acc[2] = seed;
+  acc[3] = seed - HASH_P1;
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+CINO_INLINE
+void StreamHash::consume(const unsigned char *stripe) {
+  uint64_t in[4];
+  memcpy(in, stripe, 32);
+  for (uint i = 0; i < 4; i++)
+    acc[i] = rotl(acc[i] + in[i] * HASH_P2, 31) * HASH_P1;
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+CINO_INLINE
+void StreamHash::update(const void *data, size_t size) {
+  const unsigned char *p = (const unsigned char *)data;
+  total_size += size;
+  if (tail_size > 0) { // complete the pending stripe
+    size_t k = std::min(size, 32 - tail_size);
+    memcpy(tail + tail_size, p, k);
+    tail_size += k;
+    p += k;
+    size -= k;
+    if (tail_size < 32)
+      return;
+    consume(tail);
+    tail_size = 0;
+  }
+  for (; size >= 32; p += 32, size -= 32)
+    consume(p);
+  memcpy(tail, p, size);
+  tail_size = size;
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+CINO_INLINE
+std::string StreamHash::digest() const {
+  auto finalize = [&](uint64_t h) {
+    for (uint i = 0; i < 4; i++) // merge the lanes
+      h = (h ^ (rotl(acc[i] * HASH_P2, 31) * HASH_P1)) * HASH_P1 + HASH_P4;
+    h += total_size;
+    for (size_t i = 0; i < tail_size; i++)
+      h = rotl(h ^ (tail[i] * HASH_P5), 11) * HASH_P1;
+    h ^= h >> 33; // avalanche
+    h *= HASH_P2;
+    h ^= h >> 29;
+    h *= HASH_P3;
+    h ^= h >> 32;
+    return h;
+  };
+  uint64_t h[2] = {
+      finalize(rotl(acc[0], 1) + rotl(acc[1], 7) + rotl(acc[2], 12) +
+               rotl(acc[3], 18)),
+      finalize(rotl(acc[3], 1) + rotl(acc[2], 7) + rotl(acc[1], 12) +
+               rotl(acc[0], 18) + HASH_P5)};
+  char hex[33];
+  snprintf(hex, sizeof(hex), "%016llx%016llx", (unsigned long long)h[0],
+           (unsigned long long)h[1]);
+  return std::string(hex);
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+CINO_INLINE
+KernelCache::KernelCache(const std::string &dir, const uint64_t max_bytes)
+    : dir(dir), max_bytes(max_bytes) {
+  std::error_code ec;
+  fs::create_directories(dir, ec);
+  for (const fs::directory_entry &e : fs::directory_iterator(dir, ec))
+    if (e.path().extension() == ".kernel")
+      size += e.file_size(ec);
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+CINO_INLINE
+std::string KernelCache::key(const std::vector<vec3d> &verts,
+                             const std::vector<std::vector<uint>> &faces,
+                             const double toll) {
+  StreamHash h;
+  uint64_t header[4] = {KERNEL_ALGORITHM_VERSION, verts.size(), faces.size(),
+                        0};
+  memcpy(&header[3], &toll, sizeof(double));
+  h.update(header, sizeof(header));
+
+  // vertices and faces are canonicalized in small blocks, to hash them in a
+  // single pass without copying the whole mesh
+  double coords[96];
+  uint n = 0;
+  for (const vec3d &v : verts) {
+    for (uint i = 0; i < 3; i++)
+      coords[n++] = v[i] + 0.0; // -0 becomes +0
+    if (n == 96) {
+      h.update(coords, sizeof(coords));
+      n = 0;
+    }
+  }
+  h.update(coords, n * sizeof(double));
+
+  uint32_t ids[256];
+  n = 0;
+  for (const std::vector<uint> &f : faces) {
+    if (n + f.size() + 1 > 256) {
+      h.update(ids, n * sizeof(uint32_t));
+      n = 0;
+    }
+    if (f.size() + 1 > 256) { // large face, hashed on its own
+      uint32_t k = f.size();
+      h.update(&k, sizeof(k));
+      for (uint vid : f) {
+        k = vid;
+        h.update(&k, sizeof(k));
+      }
+      continue;
+    }
+    ids[n++] = f.size();
+    for (uint vid : f)
+      ids[n++] = vid;
+  }
+  h.update(ids, n * sizeof(uint32_t));
+  return h.digest();
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+CINO_INLINE
+bool KernelCache::load(const std::string &key,
+                       std::vector<vec3d> &kernel_verts,
+                       std::vector<std::vector<uint>> &kernel_faces) {
+  std::error_code ec;
+  uint64_t file_size = fs::file_size(path(key), ec);
+  if (ec) { // not cached
+    misses++;
+    return false;
+  }
+  // a damaged file (truncated, or written by something else) is a miss, and
+  // is removed so that the kernel gets stored again
+  auto discard = [&]() {
+    misses++;
+    if (fs::remove(path(key), ec))
+      size -= std::min(size, file_size);
+    return false;
+  };
+
+  std::ifstream in(path(key), std::ios::binary);
+  char magic[4];
+  uint64_t n[3]; // verts, faces, indices
+  if (!in.read(magic, 4) || memcmp(magic, CACHE_MAGIC, 4) != 0 ||
+      !in.read((char *)n, sizeof(n)))
+    return discard();
+  // the counts must match the file size exactly, which also bounds the
+  // buffers allocated below
+  for (uint i = 0; i < 3; i++)
+    if (n[i] > file_size)
+      return discard();
+  static_assert(sizeof(vec3d) == 3 * sizeof(double), "packed vec3d");
+  if (file_size != 4 + sizeof(n) + n[0] * sizeof(vec3d) +
+                       (n[1] + n[2]) * sizeof(uint32_t))
+    return discard();
+  std::vector<vec3d> verts(n[0]);
+  std::vector<uint32_t> sizes(n[1]), ids(n[2]);
+  in.read((char *)verts.data(), n[0] * sizeof(vec3d));
+  in.read((char *)sizes.data(), n[1] * sizeof(uint32_t));
+  in.read((char *)ids.data(), n[2] * sizeof(uint32_t));
+  if (!in)
+    return discard();
+  uint64_t num_ids = 0;
+  for (uint32_t s : sizes)
+    num_ids += s;
+  if (num_ids != n[2])
+    return discard();
+  for (uint32_t vid : ids)
+    if (vid >= n[0])
+      return discard();
+  kernel_verts = std::move(verts);
+  kernel_faces.resize(n[1]);
+  size_t k = 0;
+  for (uint fid = 0; fid < n[1]; fid++) {
+    kernel_faces.at(fid).assign(ids.begin() + k,
+                                ids.begin() + k + sizes.at(fid));
+    k += sizes.at(fid);
+  }
+  hits++; // mark as recently used
+  fs::last_write_time(path(key), fs::file_time_type::clock::now(), ec);
+  return true;
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+CINO_INLINE
+void KernelCache::store(const std::string &key,
+                        const std::vector<vec3d> &kernel_verts,
+                        const std::vector<std::vector<uint>> &kernel_faces) {
+  std::vector<uint32_t> sizes, ids;
+  sizes.reserve(kernel_faces.size());
+  for (const std::vector<uint> &f : kernel_faces) {
+    sizes.push_back(f.size());
+    ids.insert(ids.end(), f.begin(), f.end());
+  }
+  uint64_t n[3] = {kernel_verts.size(), sizes.size(), ids.size()};
+
+  // written to a temporary file first, so that concurrent readers never see
+  // a partial kernel. The name is unique per process (batch workers share
+  // the directory) and per thread
+  std::string tmp = path(key) + ".tmp" + std::to_string(getpid()) + "_" +
+                    std::to_string(std::hash<std::thread::id>()(
+                        std::this_thread::get_id()));
+  {
+    std::ofstream out(tmp, std::ios::binary);
+    out.write(CACHE_MAGIC, 4);
+    out.write((const char *)n, sizeof(n));
+    out.write((const char *)kernel_verts.data(),
+              kernel_verts.size() * sizeof(vec3d));
+    out.write((const char *)sizes.data(), sizes.size() * sizeof(uint32_t));
+    out.write((const char *)ids.data(), ids.size() * sizeof(uint32_t));
+    if (!out) {
+      std::cerr << "WARNING: cannot write cache file " << tmp << std::endl;
+      return;
+    }
+  }
+  std::error_code ec;
+  fs::rename(tmp, path(key), ec);
+  if (ec) {
+    fs::remove(tmp, ec);
+    return;
+  }
+  size += 4 + sizeof(n) + kernel_verts.size() * sizeof(vec3d) +
+          (sizes.size() + ids.size()) * sizeof(uint32_t);
+  if (size > max_bytes)
+    evict();
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+CINO_INLINE
+std::string KernelCache::path(const std::string &key) const {
+  return (fs::path(dir) / (key + ".kernel")).string();
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+CINO_INLINE
+void KernelCache::evict() {
+  // removes the least recently used kernels until the cache fits max_bytes
+  struct Entry {
+    fs::path path;
+    fs::file_time_type time;
+    uint64_t size;
+  };
+  std::vector<Entry> entries;
+  std::error_code ec;
+  size = 0;
+  for (const fs::directory_entry &e : fs::directory_iterator(dir, ec))
+    if (e.path().extension() == ".kernel") {
+      entries.push_back({e.path(), e.last_write_time(ec), e.file_size(ec)});
+      size += entries.back().size;
+    }
+  std::sort(entries.begin(), entries.end(),
+            [](const Entry &a, const Entry &b) { return a.time < b.time; });
+  for (const Entry &e : entries) {
+    if (size <= max_bytes)
+      break;
+    if (fs::remove(e.path, ec)) {
+      size -= e.size;
+      evictions++;
+    }
+  }
+}
+
+} // namespace cinolib
@@ -0,0 +1,95 @@
+#ifndef KERNEL_CACHE_H
+#define KERNEL_CACHE_H
+
+// content-addressed on-disk cache of kernels. The key of a kernel is a 128 bit
+// hash of the canonicalized input (vertex coordinates with -0 turned into +0,
+// face sizes and indices), of the classification tolerance and of
+// KERNEL_ALGORITHM_VERSION. Each kernel is stored in its own binary file,
+// named after its key, in the cache directory. When the directory exceeds its
+// size limit the least recently used kernels are removed.
+
+#include "polyhedron_kernel.h"
+#include <cstdint>
+#include <string>
+
+namespace cinolib {
+
+// streamed hash with four independent 64 bit lanes (same round function as
+// xxHash64), fed 32 bytes at a time. The lanes have no dependencies on each
+// other, so the compiler can keep them in vector registers
+class StreamHash {
+
+public:
+  CINO_INLINE
+  explicit StreamHash(const uint64_t seed = 0);
+
+  CINO_INLINE
+  void update(const void *data, size_t size);
+
+  // 128 bit digest, as 32 hexadecimal digits
+  CINO_INLINE
+  std::string digest() const;
+
+private:
+  uint64_t acc[4];
+  unsigned char tail[32]; // bytes not yet consumed
+  size_t tail_size = 0;
+  uint64_t total_size = 0;
+
+  CINO_INLINE
+  void consume(const unsigned char *stripe);
+};
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+class KernelCache {
+
+public:
+  uint hits = 0;
+  uint misses = 0;
+  uint evictions = 0;
+
+  // creates dir if needed. max_bytes is the size limit of the directory
+  CINO_INLINE
+  explicit KernelCache(const std::string &dir,
+                       const uint64_t max_bytes = uint64_t(1) << 30);
+
+  CINO_INLINE
+  static std::string key(const std::vector<vec3d> &verts,
+                         const std::vector<std::vector<uint>> &faces,
+                         const double toll = ScalarTolerance<double>::kernel);
+
+  // loads the kernel stored with key, if any, and counts a hit or a miss. A
+  // cache file that fails validation counts as a miss and is removed
+  CINO_INLINE
+  bool load(const std::string &key, std::vector<vec3d> &kernel_verts,
+            std::vector<std::vector<uint>> &kernel_faces);
+
+  CINO_INLINE
+  void store(const std::string &key, const std::vector<vec3d> &kernel_verts,
+             const std::vector<std::vector<uint>> &kernel_faces);
+
+  CINO_INLINE
+  double hit_rate() const {
+    return hits + misses > 0 ? double(hits) / (hits + misses) : 0;
+  }
+
+private:
+  std::string dir;
+  uint64_t max_bytes;
+  uint64_t size = 0; // current size of the cache files
+
+  CINO_INLINE
+  std::string path(const std::string &key) const;
+
+  CINO_INLINE
+  void evict();
+};
+
+} // namespace cinolib
+
+#ifndef CINO_STATIC_LIB
+#include "kernel_cache.cpp"
+#endif
+
+#endif // KERNEL_CACHE_H
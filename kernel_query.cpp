@@ -0,0 +1,280 @@
+#include "kernel_query.h"
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <tuple>
+
+namespace cinolib {
+
+// planes tested together against each point
+static const uint QUERY_BLOCK = 8;
+// points used to sort the planes of a batch
+static const uint QUERY_SAMPLE = 1024;
+
+template <class T>
+CINO_INLINE void KernelQuery::build(const PolyhedronKernel<T> &K) {
+  planes = Planes();
+  if (K.kernel_verts.empty())
+    return;
+  // the kernel is convex, the average of its vertices is inside
+  vec3d c(0, 0, 0);
+  for (const auto &v : K.kernel_verts)
+    c += vec3d(v.x(), v.y(), v.z());
+  c /= K.kernel_verts.size();
+
+  for (const std::vector<uint> &f : K.kernel_faces) {
+    vec3d n(0, 0, 0), p(0, 0, 0);
+    for (uint i = 0; i < f.size(); i++) { // Newell's normal
+      const auto &a = K.kernel_verts.at(f.at(i));
+      const auto &b = K.kernel_verts.at(f.at((i + 1) % f.size()));
+      n[0] += (double(a[1]) - b[1]) * (double(a[2]) + b[2]);
+      n[1] += (double(a[2]) - b[2]) * (double(a[0]) + b[0]);
+      n[2] += (double(a[0]) - b[0]) * (double(a[1]) + b[1]);
+      p += vec3d(a.x(), a.y(), a.z());
+    }
+    if (f.size() < 3 || n.norm() == 0)
+      continue;
+    n.normalize();
+    p /= f.size();
+    if (n.dot(c - p) > 0) // orient the plane towards the kernel
+      n = -n;
+    planes.nx.push_back(n.x());
+    planes.ny.push_back(n.y());
+    planes.nz.push_back(n.z());
+    planes.d.push_back(n.dot(p));
+  }
+  sort_planes(c);
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+CINO_INLINE
+void KernelQuery::build(const std::vector<vec3d> &verts,
+                        const std::vector<std::vector<uint>> &faces,
+                        const std::vector<vec3d> &normals) {
+  planes = Planes();
+  vec3d c(0, 0, 0);
+  for (const vec3d &v : verts)
+    c += v;
+  if (!verts.empty())
+    c /= verts.size();
+  for (uint fid = 0; fid < faces.size(); fid++) {
+    const vec3d &n = normals.at(fid);
+    if (faces.at(fid).empty() || n.is_deg())
+      continue;
+    // the kernel lies below each face, as in PolyhedronKernel::compute
+    planes.nx.push_back(n.x());
+    planes.ny.push_back(n.y());
+    planes.nz.push_back(n.z());
+    planes.d.push_back(n.dot(verts.at(faces.at(fid).front())));
+  }
+  sort_planes(c);
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+CINO_INLINE
+void KernelQuery::sort_planes(const vec3d &c) {
+  const Planes &P = planes;
+  std::vector<uint> order(P.d.size());
+  std::iota(order.begin(), order.end(), 0);
+  // duplicated planes become adjacent
+  std::sort(order.begin(), order.end(), [&](uint a, uint b) {
+    return std::make_tuple(P.nx.at(a), P.ny.at(a), P.nz.at(a), P.d.at(a)) <
+           std::make_tuple(P.nx.at(b), P.ny.at(b), P.nz.at(b), P.d.at(b));
+  });
+  const double eps = 1e-12;
+  auto same = [&](uint a, uint b) {
+    return fabs(P.nx.at(a) - P.nx.at(b)) < eps &&
+           fabs(P.ny.at(a) - P.ny.at(b)) < eps &&
+           fabs(P.nz.at(a) - P.nz.at(b)) < eps &&
+           fabs(P.d.at(a) - P.d.at(b)) < eps;
+  };
+  order.erase(std::unique(order.begin(), order.end(), same), order.end());
+  auto slack = [&](uint i) {
+    return P.d.at(i) - P.nx.at(i) * c.x() - P.ny.at(i) * c.y() -
+           P.nz.at(i) * c.z();
+  };
+  std::stable_sort(order.begin(), order.end(),
+                   [&](uint a, uint b) { return slack(a) < slack(b); });
+
+  Planes sorted;
+  for (uint i : order) {
+    sorted.nx.push_back(P.nx.at(i));
+    sorted.ny.push_back(P.ny.at(i));
+    sorted.nz.push_back(P.nz.at(i));
+    sorted.d.push_back(P.d.at(i));
+  }
+  sorted.size = order.size();
+  pad(sorted);
+  planes = std::move(sorted);
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+CINO_INLINE
+KernelQuery::Planes
+KernelQuery::sort_planes(const std::vector<vec3d> &sample,
+                         const double toll) const {
+  const Planes &P = planes;
+  const uint n_words = (sample.size() + 63) / 64;
+  // rejected.at(i): bitmask of the sample points outside plane i
+  std::vector<std::vector<uint64_t>> rejected(
+      P.size, std::vector<uint64_t>(n_words, 0));
+  for (uint i = 0; i < P.size; i++)
+    for (uint s = 0; s < sample.size(); s++)
+      if (P.nx.at(i) * sample.at(s).x() + P.ny.at(i) * sample.at(s).y() +
+              P.nz.at(i) * sample.at(s).z() >
+          P.d.at(i) + toll)
+        rejected.at(i).at(s / 64) |= uint64_t(1) << (s % 64);
+
+  std::vector<uint64_t> covered(n_words, 0);
+  std::vector<bool> taken(P.size, false);
+  std::vector<uint> order;
+  for (;;) {
+    uint best = 0, best_count = 0;
+    for (uint i = 0; i < P.size; i++) {
+      if (taken.at(i))
+        continue;
+      uint count = 0;
+      for (uint w = 0; w < n_words; w++) {
+        uint64_t bits = rejected.at(i).at(w) & ~covered.at(w);
+        for (; bits; bits &= bits - 1) // popcount
+          count++;
+      }
+      if (count > best_count) {
+        best = i;
+        best_count = count;
+      }
+    }
+    if (best_count == 0)
+      break;
+    taken.at(best) = true;
+    order.push_back(best);
+    for (uint w = 0; w < n_words; w++)
+      covered.at(w) |= rejected.at(best).at(w);
+  }
+  for (uint i = 0; i < P.size; i++) // the others keep their order
+    if (!taken.at(i))
+      order.push_back(i);
+
+  Planes sorted;
+  for (uint i : order) {
+    sorted.nx.push_back(P.nx.at(i));
+    sorted.ny.push_back(P.ny.at(i));
+    sorted.nz.push_back(P.nz.at(i));
+    sorted.d.push_back(P.d.at(i));
+  }
+  sorted.size = order.size();
+  pad(sorted);
+  return sorted;
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+CINO_INLINE
+void KernelQuery::pad(Planes &P) {
+  while (P.d.size() % QUERY_BLOCK != 0) {
+    P.nx.push_back(0);
+    P.ny.push_back(0);
+    P.nz.push_back(0);
+    P.d.push_back(std::numeric_limits<double>::infinity());
+  }
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+CINO_INLINE
+void KernelQuery::contains(const std::vector<vec3d> &points,
+                           std::vector<uint8_t> &inside,
+                           const double toll) const {
+  inside.resize(points.size());
+  const uint n = points.size();
+  Planes sorted;
+  if (n >= 16 * QUERY_SAMPLE) { // worth sorting the planes for this batch
+    std::vector<vec3d> sample;
+    for (uint i = 0; i < QUERY_SAMPLE; i++)
+      sample.push_back(points.at(uint64_t(i) * n / QUERY_SAMPLE));
+    sorted = sort_planes(sample, toll);
+  }
+  const Planes &P = sorted.size > 0 ? sorted : planes;
+  uint n_chunks = num_chunks(n, parallel_threshold);
+  parallel_chunks(n, n_chunks, [&](uint, uint begin, uint end) {
+    contains(P, points.data() + begin, end - begin, inside.data() + begin,
+             toll);
+  });
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+CINO_INLINE
+bool KernelQuery::contains(const vec3d &p, const double toll) const {
+  uint8_t inside;
+  contains(planes, &p, 1, &inside, toll);
+  return inside;
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+// index in [0, QUERY_BLOCK) of a plane among those starting at nx, ny, nz, d
+// that has (x,y,z) outside, or QUERY_BLOCK if there is none. The distances
+// are computed by a loop of fixed length without branches, so that the
+// compiler can turn it into vector instructions
+CINO_INLINE
+static uint outside_block(const double *nx, const double *ny, const double *nz,
+                          const double *d, const double x, const double y,
+                          const double z, const double toll) {
+  double dist[QUERY_BLOCK];
+  for (uint k = 0; k < QUERY_BLOCK; k++)
+    dist[k] = nx[k] * x + ny[k] * y + nz[k] * z - d[k];
+  bool out = false;
+  for (uint k = 0; k < QUERY_BLOCK; k++)
+    out |= dist[k] > toll;
+  if (!out)
+    return QUERY_BLOCK;
+  uint k = 0; // same test as above, on the same values
+  while (!(dist[k] > toll))
+    k++;
+  return k;
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+CINO_INLINE
+void KernelQuery::contains(const Planes &P, const vec3d *points, const uint n,
+                           uint8_t *inside, const double toll) {
+  if (P.size == 0) { // empty kernel
+    std::fill(inside, inside + n, 0);
+    return;
+  }
+  const double *nx = P.nx.data(), *ny = P.ny.data(), *nz = P.nz.data(),
+               *d = P.d.data();
+  // the plane that rejected the last point is tried first, since nearby
+  // points tend to be rejected by the same plane
+  uint hint = 0;
+  for (uint i = 0; i < n; i++) {
+    const double x = points[i].x(), y = points[i].y(), z = points[i].z();
+    if (nx[hint] * x + ny[hint] * y + nz[hint] * z - d[hint] > toll) {
+      inside[i] = 0;
+      continue;
+    }
+    inside[i] = 1;
+    for (uint j = 0; j < P.d.size(); j += QUERY_BLOCK) {
+      uint k = outside_block(nx + j, ny + j, nz + j, d + j, x, y, z, toll);
+      if (k < QUERY_BLOCK) {
+        inside[i] = 0;
+        hint = j + k;
+        break;
+      }
+    }
+  }
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+#ifdef CINO_STATIC_LIB
+template void KernelQuery::build(const PolyhedronKernel<float> &K);
+template void KernelQuery::build(const PolyhedronKernel<double> &K);
+#endif
+
+} // namespace cinolib
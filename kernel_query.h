@@ -0,0 +1,85 @@
+#ifndef KERNEL_QUERY_H
+#define KERNEL_QUERY_H
+
+// batched point-in-kernel queries. The kernel is stored as a set of
+// half-spaces n.q <= d, in structure of arrays layout, and points are tested
+// in blocks: the inner loop over the points of a block has no branches, so the
+// compiler can vectorize it, and a block stops as soon as all of its points
+// are outside.
+
+#include "parallel_chunks.h"
+#include "polyhedron_kernel.h"
+#include <cstdint>
+
+namespace cinolib {
+
+class KernelQuery {
+
+public:
+  // number of points above which queries run in parallel
+  uint parallel_threshold = 100000;
+
+  CINO_INLINE
+  explicit KernelQuery() {}
+
+  // half-spaces of the kernel faces (duplicated planes are merged)
+  template <class T>
+  CINO_INLINE void build(const PolyhedronKernel<T> &K);
+
+  // half-spaces of the input faces, without computing the kernel B-rep. The
+  // answers are the same, but redundant planes are kept
+  CINO_INLINE
+  void build(const std::vector<vec3d> &verts,
+             const std::vector<std::vector<uint>> &faces,
+             const std::vector<vec3d> &normals);
+
+  CINO_INLINE
+  uint num_planes() const { return planes.size; }
+
+  // inside.at(i) is 1 if points.at(i) is in the kernel, with tolerance toll
+  // on the distance from each plane, 0 otherwise. For large batches the
+  // planes are first sorted on a sample of the points
+  CINO_INLINE
+  void contains(const std::vector<vec3d> &points, std::vector<uint8_t> &inside,
+                const double toll = 0) const;
+
+  CINO_INLINE
+  bool contains(const vec3d &p, const double toll = 0) const;
+
+private:
+  // half-spaces n.q <= d, in structure of arrays layout
+  struct Planes {
+    std::vector<double> nx, ny, nz, d;
+    uint size = 0; // planes before padding
+  };
+
+  Planes planes;
+
+  // merges duplicated planes and sorts the others by increasing slack at the
+  // point c (an inside point, when available)
+  CINO_INLINE
+  void sort_planes(const vec3d &c);
+
+  // planes sorted so that those rejecting most of the sample points come
+  // first (greedy cover of the rejected points), for early exits
+  CINO_INLINE
+  Planes sort_planes(const std::vector<vec3d> &sample,
+                     const double toll) const;
+
+  // pads the planes to a multiple of the block size, with planes that
+  // contain everything
+  CINO_INLINE
+  static void pad(Planes &P);
+
+  CINO_INLINE
+  static void contains(const Planes &P, const vec3d *points, const uint n,
+                       uint8_t *inside, const double toll);
+};
+
+} // namespace cinolib
+
+#ifndef CINO_STATIC_LIB
+#include "kernel_query.cpp"
+#endif
+
+#endif // KERNEL_QUERY_H
@@ -0,0 +1,358 @@
+#include "kernel_service.h"
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace cinolib {
+
+// buffered reader over a file descriptor
+class FdReader {
+public:
+  explicit FdReader(const int fd) : fd(fd), buf(1 << 16) {}
+
+  bool read_line(std::string &line) {
+    line.clear();
+    for (;;) {
+      if (begin == end && !fill())
+        return !line.empty();
+      char *nl = (char *)memchr(buf.data() + begin, '\n', end - begin);
+      size_t stop = nl ? nl - buf.data() : end;
+      line.append(buf.data() + begin, stop - begin);
+      begin = nl ? stop + 1 : stop;
+      if (nl)
+        return true;
+    }
+  }
+
+  bool read(char *dst, size_t n) {
+    while (n > 0) {
+      if (begin == end && !fill())
+        return false;
+      size_t k = std::min(n, end - begin);
+      memcpy(dst, buf.data() + begin, k);
+      begin += k;
+      dst += k;
+      n -= k;
+    }
+    return true;
+  }
+
+private:
+  int fd;
+  std::vector<char> buf;
+  size_t begin = 0, end = 0;
+
+  bool fill() {
+    ssize_t k;
+    do
+      k = ::read(fd, buf.data(), buf.size());
+    while (k < 0 && errno == EINTR);
+    begin = 0;
+    end = k > 0 ? k : 0;
+    return k > 0;
+  }
+};
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+CINO_INLINE
+bool parse_off(const char *data, MeshBuffer &m) {
+  const char *c = data;
+  const size_t len = strlen(data);
+  auto skip = [&]() { // whitespace and comments
+    for (;;) {
+      while (isspace(*c))
+        c++;
+      if (*c != '#')
+        return;
+      while (*c && *c != '\n')
+        c++;
+    }
+  };
+  auto next_uint = [&](uint &x) {
+    skip();
+    char *e;
+    unsigned long l = strtoul(c, &e, 10);
+    if (e == c)
+      return false;
+    x = l;
+    c = e;
+    return true;
+  };
+
+  skip();
+  if (strncmp(c, "OFF", 3) != 0)
+    return false;
+  c += 3;
+  uint nv, nf, ne;
+  if (!next_uint(nv) || !next_uint(nf) || !next_uint(ne))
+    return false;
+  // a vertex takes at least 6 characters and a face at least 2, so that
+  // counts larger than the text cannot make the buffers blow up
+  if (nv > len / 6 || nf > len / 2)
+    return false;
+  m.verts.resize(nv);
+  for (vec3d &v : m.verts)
+    for (uint i = 0; i < 3; i++) {
+      skip();
+      char *e;
+      v[i] = strtod(c, &e);
+      if (e == c)
+        return false;
+      c = e;
+    }
+  m.faces.resize(nf);
+  for (std::vector<uint> &f : m.faces) {
+    uint k;
+    if (!next_uint(k) || k > len / 2)
+      return false;
+    f.resize(k);
+    for (uint &vid : f)
+      if (!next_uint(vid) || vid >= nv)
+        return false;
+    while (*c && *c != '\n') // optional face colour
+      c++;
+  }
+  return true;
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+CINO_INLINE
+void compute_face_normals(MeshBuffer &m) {
+  m.normals.resize(m.faces.size());
+  for (uint fid = 0; fid < m.faces.size(); fid++) {
+    const std::vector<uint> &f = m.faces.at(fid);
+    vec3d n(0, 0, 0);
+    for (uint i = 0; i < f.size(); i++) {
+      const vec3d &a = m.verts.at(f.at(i));
+      const vec3d &b = m.verts.at(f.at((i + 1) % f.size()));
+      n[0] += (a[1] - b[1]) * (a[2] + b[2]);
+      n[1] += (a[2] - b[2]) * (a[0] + b[0]);
+      n[2] += (a[0] - b[0]) * (a[1] + b[1]);
+    }
+    n.normalize();
+    m.normals.at(fid) = n;
+  }
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+CINO_INLINE
+KernelService::KernelService(const uint n_threads) {
+  uint n = n_threads > 0 ? n_threads
+                         : std::max(1u, std::thread::hardware_concurrency());
+  max_jobs = 4 * n;
+  for (uint i = 0; i < n; i++)
+    workers.emplace_back(&KernelService::work, this);
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+CINO_INLINE
+KernelService::~KernelService() {
+  {
+    std::lock_guard<std::mutex> lock(jobs_mutex);
+    stopping = true;
+  }
+  jobs_ready.notify_all();
+  for (std::thread &t : workers)
+    t.join();
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+CINO_INLINE
+uint KernelService::serve(const int in_fd, const int out_fd) {
+  std::shared_ptr<Stream> out = std::make_shared<Stream>();
+  out->fd = out_fd;
+  FdReader in(in_fd);
+  std::string line, payload;
+  uint num_requests = 0;
+  while (in.read_line(line)) {
+    if (line.empty())
+      continue;
+    char type[8] = {0};
+    char id[64] = {0};
+    unsigned long a = 0, b = 0, c = 0;
+    int n = sscanf(line.c_str(), "%7s %63s %lu %lu %lu", type, id, &a, &b, &c);
+    Job job;
+    job.id = id;
+    job.out = out;
+    bool ok = false;
+    // sizes come from the client: oversized payloads are refused before
+    // allocating anything, and failed allocations are answered as errors
+    // (the payload may be unread, so the stream ends in both cases)
+    const size_t max_ids = SERVICE_MAX_PAYLOAD / sizeof(uint32_t);
+    if ((n == 3 && a > SERVICE_MAX_PAYLOAD) ||
+        (n == 5 && (a > SERVICE_MAX_PAYLOAD / sizeof(vec3d) || b > max_ids ||
+                    c > max_ids ||
+                    a * sizeof(vec3d) + (b + c) * sizeof(uint32_t) >
+                        SERVICE_MAX_PAYLOAD))) {
+      respond(*out, "ERROR " + job.id + " request too large\n", "");
+      break;
+    }
+    try {
+      if (n == 3 && strcmp(type, "OFF") == 0) {
+        payload.resize(a);
+        if (!in.read(&payload[0], a))
+          break;
+        ok = parse_off(payload.c_str(), job.mesh);
+      } else if (n == 5 && strcmp(type, "BIN") == 0) {
+        MeshBuffer &m = job.mesh;
+        std::vector<uint32_t> sizes(b), ids(c);
+        m.verts.resize(a);
+        static_assert(sizeof(vec3d) == 3 * sizeof(double), "packed vec3d");
+        if (!in.read((char *)m.verts.data(), a * sizeof(vec3d)) ||
+            !in.read((char *)sizes.data(), b * sizeof(uint32_t)) ||
+            !in.read((char *)ids.data(), c * sizeof(uint32_t)))
+          break;
+        m.faces.resize(b);
+        size_t k = 0;
+        ok = true;
+        for (uint fid = 0; fid < b && ok; fid++) {
+          ok = k + sizes.at(fid) <= c;
+          for (uint i = 0; ok && i < sizes.at(fid); i++, k++) {
+            ok = ids.at(k) < a;
+            m.faces.at(fid).push_back(ids.at(k));
+          }
+        }
+      } else {
+        respond(*out, "ERROR " + job.id + " bad request\n", "");
+        break; // the stream cannot be resynchronized
+      }
+    } catch (const std::bad_alloc &) {
+      respond(*out, "ERROR " + job.id + " out of memory\n", "");
+      break;
+    }
+    num_requests++;
+    if (!ok || job.mesh.verts.empty()) {
+      respond(*out, "ERROR " + job.id + " malformed mesh\n", "");
+      continue;
+    }
+    {
+      std::lock_guard<std::mutex> lock(out->mutex);
+      out->pending++;
+    }
+    push(std::move(job));
+  }
+  // wait for all the responses of this stream
+  std::unique_lock<std::mutex> lock(out->mutex);
+  out->done.wait(lock, [&] { return out->pending == 0; });
+  return num_requests;
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+CINO_INLINE
+int KernelService::listen(const std::string &path) {
+  signal(SIGPIPE, SIG_IGN); // clients may disconnect at any time
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (fd < 0 || path.size() >= sizeof(addr.sun_path)) {
+    std::cerr << "ERROR: cannot create socket " << path << std::endl;
+    return 1;
+  }
+  strcpy(addr.sun_path, path.c_str());
+  unlink(path.c_str());
+  if (bind(fd, (sockaddr *)&addr, sizeof(addr)) < 0 || ::listen(fd, 64) < 0) {
+    std::cerr << "ERROR: cannot listen on " << path << std::endl;
+    close(fd);
+    return 1;
+  }
+  for (;;) {
+    int conn = accept(fd, nullptr, nullptr);
+    if (conn < 0) {
+      if (errno == EINTR)
+        continue;
+      std::cerr << "ERROR: accept failed on " << path << std::endl;
+      close(fd);
+      return 1;
+    }
+    std::thread([this, conn] {
+      serve(conn, conn);
+      close(conn);
+    }).detach();
+  }
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+CINO_INLINE
+void KernelService::work() {
+  // scratch state reused across requests
+  PolyhedronKernel<> K;
+  std::string header, body;
+  for (;;) {
+    Job job;
+    {
+      std::unique_lock<std::mutex> lock(jobs_mutex);
+      jobs_ready.wait(lock, [&] { return stopping || !jobs.empty(); });
+      if (jobs.empty())
+        return;
+      job = std::move(jobs.front());
+      jobs.pop_front();
+    }
+    jobs_space.notify_one();
+
+    body.clear();
+    try {
+      compute_face_normals(job.mesh);
+      K.initialize(job.mesh.verts);
+      K.compute(job.mesh.verts, job.mesh.faces, job.mesh.normals);
+      append_kernel(K.kernel_verts, K.kernel_faces, FORMAT_OFF, false, body);
+      header = "KERNEL " + job.id + " " + std::to_string(body.size()) + "\n";
+    } catch (const std::bad_alloc &) {
+      body.clear();
+      header = "ERROR " + job.id + " out of memory\n";
+    }
+    respond(*job.out, header, body);
+
+    std::lock_guard<std::mutex> lock(job.out->mutex);
+    if (--job.out->pending == 0)
+      job.out->done.notify_all();
+  }
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+CINO_INLINE
+void KernelService::push(Job &&job) {
+  {
+    std::unique_lock<std::mutex> lock(jobs_mutex);
+    jobs_space.wait(lock, [&] { return jobs.size() < max_jobs; });
+    jobs.push_back(std::move(job));
+  }
+  jobs_ready.notify_one();
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+CINO_INLINE
+void KernelService::respond(Stream &s, const std::string &header,
+                            const std::string &body) {
+  std::lock_guard<std::mutex> lock(s.mutex);
+  for (const std::string *str : {&header, &body}) {
+    const char *p = str->data();
+    size_t n = str->size();
+    while (n > 0) {
+      ssize_t k = write(s.fd, p, n);
+      if (k < 0 && errno == EINTR)
+        continue;
+      if (k <= 0)
+        return; // the client went away
+      p += k;
+      n -= k;
+    }
+  }
+}
+
+} // namespace cinolib
@@ -0,0 +1,108 @@
+#ifndef KERNEL_SERVICE_H
+#define KERNEL_SERVICE_H
+
+// long-running kernel service: reads mesh requests from a stream (a pipe or a
+// Unix domain socket connection), computes their kernels on a pool of worker
+// threads and writes each kernel back as soon as it is ready.
+//
+// Protocol (headers are single text lines, payload sizes are in bytes):
+//   request   OFF <id> <size>\n<OFF text>
+//             BIN <id> <verts> <faces> <indices>\n<verts * 3 doubles>
+//                 <faces uint32 face sizes><indices uint32 vertex ids>
+//   response  KERNEL <id> <size>\n<OFF text>
+//             ERROR <id> <message>\n
+// <id> is chosen by the client; responses may come back out of order. Binary
+// payloads use the byte order of the machine. A request whose payload exceeds
+// SERVICE_MAX_PAYLOAD bytes, or whose mesh cannot be allocated, is answered
+// with an ERROR and ends the stream.
+
+#include "kernel_writer.h"
+#include "polyhedron_kernel.h"
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace cinolib {
+
+static const size_t SERVICE_MAX_PAYLOAD = size_t(1) << 28;
+
+// a mesh read from memory, with the face normals needed by the kernel
+struct MeshBuffer {
+  std::vector<vec3d> verts;
+  std::vector<std::vector<uint>> faces;
+  std::vector<vec3d> normals;
+};
+
+// parses an OFF mesh from data (which must be null terminated). Returns false
+// if the input is malformed, or if its counts do not fit in its length
+CINO_INLINE
+bool parse_off(const char *data, MeshBuffer &m);
+
+// unit face normals (Newell's method), as computed by Polygonmesh
+CINO_INLINE
+void compute_face_normals(MeshBuffer &m);
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+class KernelService {
+
+public:
+  // n_threads = 0 uses one worker per hardware thread
+  CINO_INLINE
+  explicit KernelService(const uint n_threads = 0);
+
+  CINO_INLINE
+  ~KernelService();
+
+  // serves the requests read from in_fd, writing the responses to out_fd,
+  // until the end of the input stream. Returns the number of requests read
+  CINO_INLINE
+  uint serve(const int in_fd, const int out_fd);
+
+  // listens on a Unix domain socket and serves each connection on its own
+  // reader thread. Returns only on error
+  CINO_INLINE
+  int listen(const std::string &path);
+
+private:
+  struct Stream {
+    int fd;
+    std::mutex mutex; // serializes the responses
+    uint pending = 0; // requests not answered yet
+    std::condition_variable done;
+  };
+
+  struct Job {
+    std::string id;
+    MeshBuffer mesh;
+    std::shared_ptr<Stream> out;
+  };
+
+  std::vector<std::thread> workers;
+  std::deque<Job> jobs;
+  std::mutex jobs_mutex;
+  std::condition_variable jobs_ready, jobs_space;
+  uint max_jobs; // readers block when the queue is full
+  bool stopping = false;
+
+  CINO_INLINE
+  void work();
+
+  CINO_INLINE
+  void push(Job &&job);
+
+  CINO_INLINE
+  static void respond(Stream &s, const std::string &header,
+                      const std::string &body);
+};
+
+} // namespace cinolib
+
+#ifndef CINO_STATIC_LIB
+#include "kernel_service.cpp"
+#endif
+
+#endif // KERNEL_SERVICE_H
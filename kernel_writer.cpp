@@ -0,0 +1,226 @@
+#include "kernel_writer.h"
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+
+namespace cinolib {
+
+CINO_INLINE
+KERNEL_FORMAT kernel_format(const std::string &path) {
+  std::string ext = path.substr(std::min(path.size(), path.rfind('.')));
+  std::transform(ext.begin(), ext.end(), ext.begin(),
+                 [](unsigned char c) { return std::tolower(c); });
+  if (ext == ".obj")
+    return FORMAT_OBJ;
+  if (ext == ".ply")
+    return FORMAT_PLY;
+  return FORMAT_OFF;
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+CINO_INLINE
+const char *kernel_extension(const KERNEL_FORMAT format) {
+  switch (format) {
+  case FORMAT_OBJ:
+    return ".obj";
+  case FORMAT_PLY:
+    return ".ply";
+  default:
+    return ".off";
+  }
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+// appends x in its shortest round trip representation (of the float nearest
+// to x, with quantize)
+CINO_INLINE
+static void append_number(const double x, const bool quantize,
+                          std::string &out) {
+  char tmp[32];
+  std::to_chars_result r = quantize ? std::to_chars(tmp, tmp + 32, float(x))
+                                    : std::to_chars(tmp, tmp + 32, x);
+  out.append(tmp, r.ptr);
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+CINO_INLINE
+static void append_uint(const uint64_t x, std::string &out) {
+  char tmp[24];
+  out.append(tmp, std::to_chars(tmp, tmp + 24, x).ptr);
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+// appends the bytes of x in little endian order
+template <class I>
+CINO_INLINE static void append_le(I x, std::string &out) {
+  for (uint i = 0; i < sizeof(I); i++, x >>= 8)
+    out.push_back(char(x & 0xff));
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+CINO_INLINE
+static void append_text(const std::vector<vec3d> &verts,
+                        const std::vector<std::vector<uint>> &faces,
+                        const KERNEL_FORMAT format, const bool quantize,
+                        std::string &out) {
+  if (format == FORMAT_OFF) {
+    out += "OFF\n";
+    append_uint(verts.size(), out);
+    out.push_back(' ');
+    append_uint(faces.size(), out);
+    out += " 0\n";
+  }
+  for (const vec3d &v : verts) {
+    if (format == FORMAT_OBJ)
+      out += "v ";
+    for (uint i = 0; i < 3; i++) {
+      append_number(v[i], quantize, out);
+      out.push_back(i < 2 ? ' ' : '\n');
+    }
+  }
+  for (const std::vector<uint> &f : faces) {
+    if (format == FORMAT_OBJ)
+      out.push_back('f'); // 1-based indices
+    else
+      append_uint(f.size(), out);
+    for (uint vid : f) {
+      out.push_back(' ');
+      append_uint(format == FORMAT_OBJ ? vid + 1 : vid, out);
+    }
+    out.push_back('\n');
+  }
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+CINO_INLINE
+static void append_ply(const std::vector<vec3d> &verts,
+                       const std::vector<std::vector<uint>> &faces,
+                       const bool quantize, std::string &out) {
+  size_t max_size = 0;
+  for (const std::vector<uint> &f : faces)
+    max_size = std::max(max_size, f.size());
+  const bool small = max_size < 256; // face sizes fit in a byte
+  const char *type = quantize ? "float" : "double";
+  out += "ply\nformat binary_little_endian 1.0\nelement vertex ";
+  append_uint(verts.size(), out);
+  for (const char *axis : {"x", "y", "z"})
+    out.append("\nproperty ").append(type).append(" ").append(axis);
+  out += "\nelement face ";
+  append_uint(faces.size(), out);
+  out += small ? "\nproperty list uchar int vertex_indices\nend_header\n"
+               : "\nproperty list uint int vertex_indices\nend_header\n";
+  for (const vec3d &v : verts)
+    for (uint i = 0; i < 3; i++)
+      if (quantize) {
+        float x = float(v[i]);
+        uint32_t bits;
+        memcpy(&bits, &x, sizeof(x));
+        append_le(bits, out);
+      } else {
+        double x = v[i];
+        uint64_t bits;
+        memcpy(&bits, &x, sizeof(x));
+        append_le(bits, out);
+      }
+  for (const std::vector<uint> &f : faces) {
+    if (small)
+      out.push_back(char(f.size()));
+    else
+      append_le(uint32_t(f.size()), out);
+    for (uint vid : f)
+      append_le(uint32_t(vid), out);
+  }
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+CINO_INLINE
+void append_kernel(const std::vector<vec3d> &verts,
+                   const std::vector<std::vector<uint>> &faces,
+                   const KERNEL_FORMAT format, const bool quantize,
+                   std::string &out) {
+  if (format == FORMAT_PLY)
+    append_ply(verts, faces, quantize, out);
+  else
+    append_text(verts, faces, format, quantize, out);
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+CINO_INLINE
+KernelWriter::KernelWriter(const std::string &path, const size_t buffer_size)
+    : buffer_size(buffer_size) {
+  file = fopen(path.c_str(), "wb");
+  buffer.reserve(buffer_size);
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+CINO_INLINE
+bool KernelWriter::write(const std::vector<vec3d> &verts,
+                         const std::vector<std::vector<uint>> &faces,
+                         const KERNEL_FORMAT format, const bool quantize) {
+  if (!ok())
+    return false;
+  append_kernel(verts, faces, format, quantize, buffer);
+  if (buffer.size() >= buffer_size)
+    flush();
+  return ok();
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+CINO_INLINE
+bool KernelWriter::write_record(const std::string &name,
+                                const std::vector<vec3d> &verts,
+                                const std::vector<std::vector<uint>> &faces,
+                                const KERNEL_FORMAT format,
+                                const bool quantize) {
+  if (!ok())
+    return false;
+  payload.clear();
+  append_kernel(verts, faces, format, quantize, payload);
+  buffer += "KERNEL ";
+  for (char c : name)
+    buffer.push_back(std::isspace((unsigned char)c) ? '_' : c);
+  buffer.push_back(' ');
+  append_uint(payload.size(), buffer);
+  buffer.push_back('\n');
+  buffer += payload;
+  if (buffer.size() >= buffer_size)
+    flush();
+  return ok();
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+CINO_INLINE
+void KernelWriter::flush() {
+  if (file && !buffer.empty() &&
+      fwrite(buffer.data(), 1, buffer.size(), file) != buffer.size())
+    failed = true;
+  buffer.clear();
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+CINO_INLINE
+bool KernelWriter::close() {
+  if (file == nullptr)
+    return false;
+  flush();
+  if (fclose(file) != 0)
+    failed = true;
+  file = nullptr;
+  return !failed;
+}
+
+} // namespace cinolib
@@ -0,0 +1,99 @@
+#ifndef KERNEL_WRITER_H
+#define KERNEL_WRITER_H
+
+// writers for kernels (or any polygon soup given as flat vertex and face
+// arrays) in OFF, OBJ and binary PLY format, without building a mesh. Text
+// coordinates use the shortest representation that reads back to the same
+// value; with quantization they are rounded to float first, which roughly
+// halves the output size.
+//
+// KernelWriter buffers the output of a file, and can also write a container
+// of many kernels (e.g. the results of a batch), as a sequence of records
+//   KERNEL <name> <size>\n<kernel file, size bytes>
+// with the same header as the responses of the kernel service.
+
+#include <cinolib/cino_inline.h>
+#include <cinolib/geometry/vec_mat.h>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace cinolib {
+
+enum KERNEL_FORMAT {
+  FORMAT_OFF = 0,
+  FORMAT_OBJ = 1,
+  FORMAT_PLY = 2, // binary little endian
+};
+
+// format given by the extension of path (.off, .obj or .ply, case
+// insensitive), OFF for anything else
+CINO_INLINE
+KERNEL_FORMAT kernel_format(const std::string &path);
+
+// extension of the files in format, with the dot
+CINO_INLINE
+const char *kernel_extension(const KERNEL_FORMAT format);
+
+// appends verts and faces to out in format. With quantize, coordinates are
+// written in single precision
+CINO_INLINE
+void append_kernel(const std::vector<vec3d> &verts,
+                   const std::vector<std::vector<uint>> &faces,
+                   const KERNEL_FORMAT format, const bool quantize,
+                   std::string &out);
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+class KernelWriter {
+
+public:
+  // opens path for writing; the output is flushed every buffer_size bytes
+  CINO_INLINE
+  explicit KernelWriter(const std::string &path,
+                        const size_t buffer_size = 1 << 20);
+
+  CINO_INLINE
+  ~KernelWriter() { close(); }
+
+  KernelWriter(const KernelWriter &) = delete;
+  KernelWriter &operator=(const KernelWriter &) = delete;
+
+  // false if the file could not be opened or written
+  CINO_INLINE
+  bool ok() const { return file != nullptr && !failed; }
+
+  // writes verts and faces as a single kernel file
+  CINO_INLINE
+  bool write(const std::vector<vec3d> &verts,
+             const std::vector<std::vector<uint>> &faces,
+             const KERNEL_FORMAT format, const bool quantize = false);
+
+  // appends a container record. Whitespace in name becomes '_'
+  CINO_INLINE
+  bool write_record(const std::string &name, const std::vector<vec3d> &verts,
+                    const std::vector<std::vector<uint>> &faces,
+                    const KERNEL_FORMAT format, const bool quantize = false);
+
+  // flushes and closes the file, returns ok()
+  CINO_INLINE
+  bool close();
+
+private:
+  FILE *file = nullptr;
+  bool failed = false;
+  size_t buffer_size;
+  std::string buffer;  // pending output
+  std::string payload; // record being built
+
+  CINO_INLINE
+  void flush();
+};
+
+} // namespace cinolib
+
+#ifndef CINO_STATIC_LIB
+#include "kernel_writer.cpp"
+#endif
+
+#endif // KERNEL_WRITER_H
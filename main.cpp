@@ -1,32 +1,545 @@
+#include "batch_runner.h"
+#include "kernel_archive.h"
+#include "kernel_cache.h"
+#include "kernel_query.h"
+#include "kernel_service.h"
+#include "kernel_writer.h"
 #include "polyhedron_kernel.h"
 #include <chrono>
 #include <cinolib/meshes/meshes.h>
+#include <fstream>
+#include <future>
+#include <sstream>
 
 using namespace cinolib;
 
+// input mesh, from a file or an archive entry (see kernel_archive.h), with
+// its allocations attributed to the load phase. The last archive read is kept
+// open in archive. Unreadable entries give an empty mesh
+Polygonmesh<> load_mesh(const std::string &input,
+                        std::unique_ptr<ZipArchive> &archive) {
+  KERNEL_MEMORY_PHASE(PHASE_LOAD);
+  std::string archive_path, entry;
+  if (!split_archive_path(input, archive_path, entry))
+    return Polygonmesh<>(input.c_str());
+  if (!archive || archive->path() != archive_path)
+    archive.reset(new ZipArchive(archive_path));
+  int eid = archive->find(entry);
+  std::string data, error = archive->ok() ? "no such entry" : "cannot open";
+  MeshBuffer mesh;
+  if (eid >= 0 && archive->read(eid, data, error)) {
+    if (parse_off(data.c_str(), mesh))
+      return Polygonmesh<>(mesh.verts, mesh.faces);
+    error = "malformed OFF";
+  }
+  std::cerr << "Cannot read " << input << ": " << error << std::endl;
+  return Polygonmesh<>();
+}
+
+// exact kernel of m, loaded from the cache when available. If the budget
+// expires, the kernel is partial and is not cached
+void compute_kernel(const Polygonmesh<> &m, PolyhedronKernel<> &K,
+                    KernelMetrics &km, KernelCache *cache,
+                    const PolyhedronKernel<>::SEED_TYPE &seed =
+                        PolyhedronKernel<>::SEED_AABB,
+                    const ComputeBudget *budget = nullptr) {
+  std::string key;
+  if (cache) {
+    key = KernelCache::key(m.vector_verts(), m.vector_polys());
+    if (cache->load(key, K.kernel_verts, K.kernel_faces)) {
+      K.kernel_face_planes.assign(K.kernel_faces.size(), -1); // not cached
+      K.num_clips = 0;
+      km = K.compute_metrics();
+      return;
+    }
+  }
+  K.initialize(m.vector_verts(), seed);
+  K.compute(m.vector_verts(), m.vector_polys(), m.vector_poly_normals(), false,
+            &km, budget);
+  if (cache && K.num_unapplied == 0)
+    cache->store(key, K.kernel_verts, K.kernel_faces);
+}
+
+// prints the cache statistics
+void print_cache_stats(const KernelCache &cache, std::ostream &out) {
+  out << "Cache: " << cache.hits << " hits, " << cache.misses << " misses ("
+      << 100 * cache.hit_rate() << "% hit rate), " << cache.evictions
+      << " evictions" << std::endl;
+}
+
+// CSV columns of the batch results, after the mesh name. With memory
+// profiling, the peak of live heap bytes and, for each phase, the
+// allocations, bytes allocated and peak live bytes follow the kernel metrics
+std::string batch_columns() {
+  std::string columns =
+      "verts,faces,kernel_verts,kernel_faces,clips,time_ms,volume,"
+      "centroid_x,centroid_y,centroid_z,bbox_min_x,bbox_min_y,bbox_min_z,"
+      "bbox_max_x,bbox_max_y,bbox_max_z";
+  if (MemoryProfile::enabled()) {
+    columns += ",peak_live";
+    for (int p = 0; p < NUM_MEMORY_PHASES; p++) {
+      std::string name = MemoryProfile::phase_name(MEMORY_PHASE(p));
+      columns += "," + name + "_allocs," + name + "_bytes," + name +
+                 "_peak_live";
+    }
+  }
+  return columns;
+}
+
+// CSV fields of the kernel K of m, computed in time_ms
+std::string batch_fields(const Polygonmesh<> &m, const PolyhedronKernel<> &K,
+                         const KernelMetrics &km, const long long time_ms) {
+  std::ostringstream fields;
+  fields << m.num_verts() << "," << m.num_polys() << ","
+         << K.kernel_verts.size() << "," << K.kernel_faces.size() << ","
+         << K.num_clips << "," << time_ms << "," << km.volume << ","
+         << km.centroid.x() << "," << km.centroid.y() << ","
+         << km.centroid.z() << "," << km.bbox_min.x() << ","
+         << km.bbox_min.y() << "," << km.bbox_min.z() << ","
+         << km.bbox_max.x() << "," << km.bbox_max.y() << ","
+         << km.bbox_max.z();
+  if (MemoryProfile::enabled()) {
+    fields << "," << MemoryProfile::peak_live();
+    for (int p = 0; p < NUM_MEMORY_PHASES; p++) {
+      MemoryPhaseStats ms = MemoryProfile::stats(MEMORY_PHASE(p));
+      fields << "," << ms.allocs << "," << ms.bytes << "," << ms.peak_live;
+    }
+  }
+  return fields.str();
+}
+
+// batch mode: computes the kernel of each input mesh and prints one CSV line
+// per mesh with its size, elapsed time and kernel metrics (see
+// batch_columns). With a writer, each kernel is also streamed to it as a
+// container record named after the input mesh. The next mesh is loaded (and
+// inflated, for archive entries) while the kernel of the current one is
+// computed, except with memory profiling, whose phases are shared by all
+// threads
+int batch(const std::vector<std::string> &inputs, KernelCache *cache,
+          KernelWriter *writer, const KERNEL_FORMAT format,
+          const bool quantize) {
+  std::cout << "mesh," << batch_columns() << std::endl;
+  const bool prefetch = !MemoryProfile::enabled();
+  std::unique_ptr<ZipArchive> archive; // used by one load at a time
+  auto load = [&](const uint i) {
+    return std::unique_ptr<Polygonmesh<>>(
+        new Polygonmesh<>(load_mesh(inputs.at(i), archive)));
+  };
+  std::future<std::unique_ptr<Polygonmesh<>>> next;
+  if (prefetch && !inputs.empty())
+    next = std::async(std::launch::async, load, 0);
+  for (uint i = 0; i < inputs.size(); i++) {
+    const std::string &input = inputs.at(i);
+    MemoryProfile::reset();
+    std::unique_ptr<Polygonmesh<>> mesh = prefetch ? next.get() : load(i);
+    if (prefetch && i + 1 < inputs.size())
+      next = std::async(std::launch::async, load, i + 1);
+    const Polygonmesh<> &m = *mesh;
+
+    auto start = std::chrono::steady_clock::now();
+
+    PolyhedronKernel<> K;
+    KernelMetrics km;
+    compute_kernel(m, K, km, cache);
+
+    auto time = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start);
+
+    // the line is written at once, since the loader may print meanwhile
+    std::cout << input + "," + batch_fields(m, K, km, time.count()) + "\n"
+              << std::flush;
+    if (writer)
+      writer->write_record(input, K.kernel_verts, K.kernel_faces, format,
+                           quantize);
+  }
+  if (cache)
+    print_cache_stats(*cache, std::cerr); // stdout is for the CSV
+  if (writer && !writer->close()) {
+    std::cerr << "Cannot write the kernels" << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+// batch mode with a worker process per mesh, within limits (see
+// batch_runner.h). Lines have the status of the mesh after its name, and
+// failed meshes are reported rather than stopping the batch. Each worker
+// opens the cache itself (the statistics of a forked copy would be lost),
+// and reports its hit or miss in a last cache column
+int batch_workers(const std::vector<std::string> &inputs,
+                  const std::string &cache_dir, const uint64_t cache_size,
+                  const RunnerLimits &limits) {
+  const std::string columns =
+      batch_columns() + (cache_dir.empty() ? "" : ",cache");
+  std::cout << "mesh,status," << columns << std::endl;
+  auto job = [&](const std::string &input) {
+    MemoryProfile::reset();
+    std::unique_ptr<ZipArchive> archive;
+    Polygonmesh<> m = load_mesh(input, archive);
+    std::unique_ptr<KernelCache> cache;
+    if (!cache_dir.empty())
+      cache.reset(new KernelCache(cache_dir, cache_size));
+    auto start = std::chrono::steady_clock::now();
+    PolyhedronKernel<> K;
+    KernelMetrics km;
+    compute_kernel(m, K, km, cache.get());
+    auto time = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start);
+    std::string fields = batch_fields(m, K, km, time.count());
+    if (cache)
+      fields += cache->hits > 0 ? ",hit" : ",miss";
+    return fields;
+  };
+  uint num_fields = std::count(columns.begin(), columns.end(), ',') + 1;
+  uint failed = run_workers(inputs, limits, job, num_fields, std::cout);
+  std::cerr << inputs.size() - failed << " of " << inputs.size()
+            << " meshes completed" << std::endl;
+  return 0;
+}
+
+// saves the H-representation of a kernel as a text file with a header line
+//   H <number of half-spaces>
+// followed by a line "face_id nx ny nz offset" for each half-space
+// n.dot(x) <= offset (face_id is -1 for the planes of the initial box)
+bool save_half_spaces(const std::string &path,
+                      const std::vector<KernelHalfSpace> &half_spaces) {
+  std::ofstream out(path);
+  out.precision(17);
+  out << "H " << half_spaces.size() << "\n";
+  for (const KernelHalfSpace &h : half_spaces)
+    out << h.face_id << " " << h.normal.x() << " " << h.normal.y() << " "
+        << h.normal.z() << " " << h.offset << "\n";
+  return bool(out.flush());
+}
+
+// reads the points of a text file, one "x y z" per line
+bool load_points(const std::string &path, std::vector<vec3d> &points) {
+  std::ifstream in(path);
+  if (!in)
+    return false;
+  double x, y, z;
+  while (in >> x >> y >> z)
+    points.push_back(vec3d(x, y, z));
+  return in.eof();
+}
+
+// service mode: serves kernel requests (see kernel_service.h) on the Unix
+// domain socket at path, or on stdin/stdout if path is empty
+int serve(const std::string &path) {
+  KernelService service;
+  if (!path.empty())
+    return service.listen(path);
+  // stdout carries the responses, log messages go to stderr
+  std::streambuf *cout_buf = std::cout.rdbuf(std::cerr.rdbuf());
+  uint n = service.serve(0, 1);
+  std::cout.rdbuf(cout_buf);
+  std::cerr << "Served " << n << " requests" << std::endl;
+  return 0;
+}
+
 int main(int argc, char *argv[]) {
-  std::string input =
-      (argc == 2) ? std::string(argv[1])
-                  : std::string(DATA_PATH) + "Complex_Models/rt4_arm.off";
+  if (argc > 1 && std::string(argv[1]) == "--serve")
+    return serve(argc > 2 ? argv[2] : "");
+  if (argc > 1 && std::string(argv[1]) == "--merge")
+    return merge_results(std::vector<std::string>(argv + 2, argv + argc),
+                         std::cout)
+               ? 0
+               : 1;
+
+  std::string input = std::string(DATA_PATH) + "Complex_Models/rt4_arm.off";
+  double approx_toll = 0; // 0: exact kernel
+  PolyhedronKernel<>::SEED_TYPE seed = PolyhedronKernel<>::SEED_AABB;
+  bool float_first = false;
+  bool randomized = false;
+  bool race = false;
+  std::vector<double> section; // point and normal of the slicing plane
+  bool aabb = false;
+  uint simplify_interval = 0; // 0: no simplification between clips
+  bool lazy_faces = false;
+  std::string cache_dir;
+  uint64_t cache_size = uint64_t(1) << 30;
+  double deadline_ms = 0; // 0: no deadline
+  bool batch_mode = false;
+  std::string output; // kernel file, or container of the kernels in batch mode
+  KERNEL_FORMAT format = FORMAT_OFF;
+  bool format_set = false; // otherwise given by the output extension
+  bool quantize = false;
+  std::string half_spaces; // H-representation file
+  std::string query; // points to test against the kernel
+  RunnerLimits limits;
+  bool use_workers = false;
+  uint shard = 0, num_shards = 1;
+  std::vector<std::string> inputs;
+  for (int i = 1; i < argc; i++) {
+    std::string arg(argv[i]);
+    if (arg == "--batch")
+      batch_mode = true;
+    else if (arg == "--cache" && i + 1 < argc)
+      cache_dir = argv[++i];
+    else if (arg == "--cache-size" && i + 1 < argc)
+      cache_size = std::stoull(argv[++i]) << 20;
+    else if (arg == "--deadline" && i + 1 < argc)
+      deadline_ms = std::stod(argv[++i]);
+    else if (arg == "--approx" && i + 1 < argc)
+      approx_toll = std::stod(argv[++i]);
+    else if (arg == "--obb")
+      seed = PolyhedronKernel<>::SEED_OBB;
+    else if (arg == "--float")
+      float_first = true;
+    else if (arg == "--randomized")
+      randomized = true;
+    else if (arg == "--race")
+      race = true;
+    else if (arg == "--aabb")
+      aabb = true;
+    else if (arg == "--section" && i + 6 < argc)
+      for (int j = 0; j < 6; j++)
+        section.push_back(std::stod(argv[++i]));
+    else if (arg == "--lazy-faces")
+      lazy_faces = true;
+    else if (arg == "--simplify" && i + 1 < argc)
+      simplify_interval = std::stoul(argv[++i]);
+    else if (arg == "--output" && i + 1 < argc)
+      output = argv[++i];
+    else if (arg == "--format" && i + 1 < argc) {
+      format = kernel_format(std::string(".") + argv[++i]);
+      format_set = true;
+    } else if (arg == "--quantize")
+      quantize = true;
+    else if (arg == "--half-spaces" && i + 1 < argc)
+      half_spaces = argv[++i];
+    else if (arg == "--query" && i + 1 < argc)
+      query = argv[++i];
+    else if (arg == "--jobs" && i + 1 < argc) {
+      limits.workers = std::stoul(argv[++i]);
+      use_workers = true;
+    } else if (arg == "--time-limit" && i + 1 < argc) {
+      limits.time_limit = std::stod(argv[++i]);
+      use_workers = true;
+    } else if (arg == "--memory-limit" && i + 1 < argc) {
+      limits.memory_limit = std::stoull(argv[++i]) << 20;
+      use_workers = true;
+    } else if (arg == "--shard" && i + 1 < argc) {
+      std::string s = argv[++i]; // i/n
+      shard = std::stoul(s);
+      num_shards = std::stoul(s.substr(s.find('/') + 1));
+    }
+    else
+      inputs.push_back(arg);
+  }
+  // at most one method and one mode; the options of a single kernel are
+  // rejected rather than ignored by the modes that do not compute it
+  const int num_methods = (approx_toll > 0) + float_first + randomized + race;
+  const int num_modes = batch_mode + !section.empty() + aabb;
+  const bool kernel_options =
+      num_methods > 0 || seed != PolyhedronKernel<>::SEED_AABB ||
+      simplify_interval > 0 || lazy_faces || !half_spaces.empty() ||
+      !query.empty() || deadline_ms > 0;
+  if (num_methods > 1) {
+    std::cerr << "--approx, --float, --randomized and --race cannot be combined"
+              << std::endl;
+    return 1;
+  }
+  if (num_modes > 1) {
+    std::cerr << "--batch, --section and --aabb cannot be combined"
+              << std::endl;
+    return 1;
+  }
+  if (num_modes > 0 && kernel_options) {
+    std::cerr << "--approx, --float, --randomized, --race, --obb, --simplify, "
+                 "--lazy-faces, --half-spaces, --query and --deadline are not "
+                 "supported with --batch, --section or --aabb"
+              << std::endl;
+    return 1;
+  }
+  std::unique_ptr<KernelCache> cache;
+  if (!cache_dir.empty())
+    cache.reset(new KernelCache(cache_dir, cache_size));
+  if (!format_set && !output.empty())
+    format = kernel_format(output);
+  if (batch_mode) {
+    if (shard >= num_shards) {
+      std::cerr << "Invalid shard " << shard << "/" << num_shards << std::endl;
+      return 1;
+    }
+    inputs = shard_inputs(expand_archive_inputs(inputs), shard, num_shards);
+    if (use_workers) {
+      if (!output.empty()) {
+        std::cerr << "--output is not supported with worker processes"
+                  << std::endl;
+        return 1;
+      }
+      return batch_workers(inputs, cache_dir, cache_size, limits);
+    }
+    std::unique_ptr<KernelWriter> writer;
+    if (!output.empty())
+      writer.reset(new KernelWriter(output));
+    return batch(inputs, cache.get(), writer.get(), format, quantize);
+  }
+  if (!inputs.empty())
+    input = inputs.back();
+
   std::cout << "Input: " << input << std::endl;
-  Polygonmesh<> m(input.c_str());
+  MemoryProfile::reset();
+  std::unique_ptr<ZipArchive> archive;
+  Polygonmesh<> m = load_mesh(input, archive);
+
+  if (!section.empty()) { // the cross-section alone, no 3D kernel
+    auto start = std::chrono::steady_clock::now();
+    ExtendedPlane<> plane(vec3d(section[0], section[1], section[2]),
+                          vec3d(section[3], section[4], section[5]));
+    std::vector<vec3d> polygon;
+    PolyhedronKernel<>::cross_section(m.vector_verts(), m.vector_polys(),
+                                      m.vector_poly_normals(), plane, polygon);
+    auto time = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start);
+    vec3d area(0, 0, 0);
+    for (uint i = 0; i < polygon.size(); i++)
+      area += polygon.at(i).cross(polygon.at((i + 1) % polygon.size()));
+    std::cout << "Cross-section: " << polygon.size() << " verts, area "
+              << 0.5 * area.dot(plane.n) << std::endl
+              << "Elapsed time: " << time.count() / 1000.0 << " ms"
+              << std::endl;
+    for (const vec3d &p : polygon)
+      std::cout << p << std::endl;
+    return 0;
+  }
+
+  if (aabb) { // the kernel bounding box alone, no 3D kernel
+    auto start = std::chrono::steady_clock::now();
+    vec3d min, max;
+    bool ok = PolyhedronKernel<>::kernel_aabb(
+        m.vector_verts(), m.vector_polys(), m.vector_poly_normals(), min, max);
+    auto time = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start);
+    if (ok)
+      std::cout << "Kernel bbox: [" << min << "] [" << max << "]" << std::endl;
+    else
+      std::cout << "Empty kernel" << std::endl;
+    std::cout << "Elapsed time: " << time.count() / 1000.0 << " ms"
+              << std::endl;
+    return 0;
+  }
 
   auto start = std::chrono::steady_clock::now();
 
-  PolyhedronKernel K;
-  K.initialize(m.vector_verts());
-  K.compute(m.vector_verts(), m.vector_polys(), m.vector_poly_normals());
+  PolyhedronKernel<> K;
+  K.simplify_interval = simplify_interval;
+  K.lazy_faces = lazy_faces;
+  K.output_half_spaces = !half_spaces.empty();
+  KernelMetrics km;
+  double hausdorff_bound = 0;
+  ComputeBudget budget;
+  if (deadline_ms > 0)
+    budget.deadline =
+        start + std::chrono::microseconds((long long)(deadline_ms * 1000));
+  if (approx_toll > 0) {
+    K.initialize(m.vector_verts(), seed);
+    hausdorff_bound = K.compute_approximate(
+        m.vector_verts(), m.vector_polys(), m.vector_poly_normals(),
+        approx_toll, &km, &budget);
+  } else if (float_first) {
+    K.initialize(m.vector_verts(), seed);
+    if (!K.compute_float_first(m.vector_verts(), m.vector_polys(),
+                               m.vector_poly_normals(), false, seed, &km,
+                               &budget))
+      std::cout << "Single precision kernel rejected, recomputed in double"
+                << std::endl;
+  } else if (randomized) {
+    K.initialize(m.vector_verts(), seed);
+    K.compute_randomized(m.vector_verts(), m.vector_polys(),
+                         m.vector_poly_normals(), 0, &km, &budget);
+  } else if (race) {
+    K.initialize(m.vector_verts(), seed);
+    PolyhedronKernel<>::PLANE_ORDER winner =
+        K.compute_race(m.vector_verts(), m.vector_polys(),
+                       m.vector_poly_normals(), 0, &km, &budget);
+    std::cout << "Race won by the " << PolyhedronKernel<>::order_name(winner)
+              << " order" << std::endl;
+  } else // cached kernels are computed from the AABB seed, unsimplified, with
+         // the faces clipped at each cut, and have no half-spaces
+    compute_kernel(m, K, km,
+                   seed == PolyhedronKernel<>::SEED_AABB &&
+                           simplify_interval == 0 && !lazy_faces &&
+                           half_spaces.empty()
+                       ? cache.get()
+                       : nullptr,
+                   seed, &budget);
 
   auto time = std::chrono::duration_cast<std::chrono::milliseconds>(
       std::chrono::steady_clock::now() - start);
 
-  Polygonmesh<> kernel(K.kernel_verts, K.kernel_faces);
-  std::cout << "Kernel: " << kernel.num_verts() << " verts, "
-            << kernel.num_polys() << " faces" << std::endl
-            << "Elapsed time: " << time.count() << " ms" << std::endl;
+  if (approx_toll > 0)
+    std::cout << "Approximate kernel, Hausdorff distance bound: "
+              << hausdorff_bound << std::endl;
+  if (K.num_unapplied > 0)
+    std::cout << "Deadline expired with " << K.num_unapplied
+              << " planes unapplied: the kernel is an outer approximation"
+              << std::endl;
+  std::cout << "Kernel: " << K.kernel_verts.size() << " verts, "
+            << K.kernel_faces.size() << " faces" << std::endl
+            << "Clipping planes: " << K.num_clips << std::endl
+            << "Elapsed time: " << time.count() << " ms" << std::endl
+            << "Volume: " << km.volume << " centroid: " << km.centroid
+            << " bbox: [" << km.bbox_min << "] [" << km.bbox_max << "]"
+            << std::endl;
+  if (simplify_interval > 0)
+    std::cout << "Simplification removed " << K.num_simplified_verts
+              << " verts, " << K.num_simplified_faces << " faces" << std::endl;
+  if (cache)
+    print_cache_stats(*cache, std::cout);
+
+  vec3d center;
+  double radius;
+  if (K.chebyshev_center(center, radius))
+    std::cout << "Chebyshev centre: " << center << " radius: " << radius
+              << std::endl;
 
-  input.erase(input.end() - 4, input.end());
-  std::string output = input + "_kernel.off";
-  kernel.save(output.c_str());
+  if (output.empty()) { // next to the input, or in the working directory
+    std::string archive_path, entry;
+    if (split_archive_path(input, archive_path, entry))
+      input = entry.substr(entry.rfind('/') + 1);
+    input.erase(input.end() - 4, input.end());
+    output = input + "_kernel" + kernel_extension(format);
+  }
+  bool saved;
+  {
+    KERNEL_MEMORY_PHASE(PHASE_OUTPUT);
+    KernelWriter writer(output);
+    saved = writer.write(K.kernel_verts, K.kernel_faces, format, quantize) &&
+            writer.close();
+  }
+  if (!saved) {
+    std::cerr << "Cannot write " << output << std::endl;
+    return 1;
+  }
   std::cout << "Saved in: " << output << std::endl;
+  if (!half_spaces.empty()) {
+    if (!save_half_spaces(half_spaces, K.kernel_half_spaces)) {
+      std::cerr << "Cannot write " << half_spaces << std::endl;
+      return 1;
+    }
+    std::cout << "Half-spaces (" << K.kernel_half_spaces.size()
+              << ") saved in: " << half_spaces << std::endl;
+  }
+  if (!query.empty()) {
+    std::vector<vec3d> points;
+    if (!load_points(query, points)) {
+      std::cerr << "Cannot read " << query << std::endl;
+      return 1;
+    }
+    auto query_start = std::chrono::steady_clock::now();
+    KernelQuery Q;
+    Q.build(K);
+    std::vector<uint8_t> inside;
+    Q.contains(points, inside);
+    auto query_time = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - query_start);
+    std::cout << "Query: " << std::count(inside.begin(), inside.end(), 1)
+              << " of " << points.size() << " points in the kernel ("
+              << Q.num_planes() << " planes), " << query_time.count() / 1000.0
+              << " ms" << std::endl;
+  }
+  if (MemoryProfile::enabled())
+    MemoryProfile::print(std::cout);
 }
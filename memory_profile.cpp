@@ -0,0 +1,198 @@
+#include "memory_profile.h"
+#include <cstdlib>
+#include <iomanip>
+#include <new>
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+namespace cinolib {
+
+CINO_INLINE
+static void atomic_max(std::atomic<uint64_t> &a, const uint64_t v) {
+  uint64_t cur = a.load(std::memory_order_relaxed);
+  while (cur < v && !a.compare_exchange_weak(cur, v, std::memory_order_relaxed))
+    ;
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+// peak resident set size of the process, in bytes (0 if not available)
+CINO_INLINE
+static uint64_t peak_rss() {
+#if defined(__unix__) || defined(__APPLE__)
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0)
+    return 0;
+#if defined(__APPLE__)
+  return usage.ru_maxrss; // bytes
+#else
+  return uint64_t(usage.ru_maxrss) * 1024; // kilobytes
+#endif
+#else
+  return 0;
+#endif
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+CINO_INLINE
+bool MemoryProfile::enabled() {
+#ifdef KERNEL_MEMORY_PROFILE
+  return true;
+#else
+  return false;
+#endif
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+CINO_INLINE
+const char *MemoryProfile::phase_name(const MEMORY_PHASE phase) {
+  static const char *names[NUM_MEMORY_PHASES] = {
+      "other", "load", "planes", "classify", "clip", "cap", "output"};
+  return names[phase];
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+CINO_INLINE
+MemoryProfile::State &MemoryProfile::state() {
+  static State s;
+  return s;
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+CINO_INLINE
+MemoryPhaseStats MemoryProfile::stats(const MEMORY_PHASE phase) {
+  sample_rss();
+  const Counters &c = state().phases[phase];
+  MemoryPhaseStats s;
+  s.allocs = c.allocs;
+  s.bytes = c.bytes;
+  s.peak_live = c.peak_live;
+  s.rss_growth = c.rss_growth;
+  return s;
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+CINO_INLINE
+uint64_t MemoryProfile::peak_live() { return state().peak_live; }
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+CINO_INLINE
+void MemoryProfile::reset() {
+  State &s = state();
+  s.peak_live = s.live.load();
+  s.last_rss = peak_rss();
+  for (Counters &c : s.phases) {
+    c.allocs = 0;
+    c.bytes = 0;
+    c.peak_live = s.live.load();
+    c.rss_growth = 0;
+  }
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+CINO_INLINE
+void MemoryProfile::print(std::ostream &out) {
+  const double MB = 1 << 20;
+  out << "Memory (phase, allocations, MB allocated, peak MB live, MB RSS "
+         "growth):"
+      << std::endl;
+  for (int p = 0; p < NUM_MEMORY_PHASES; p++) {
+    MemoryPhaseStats s = stats(MEMORY_PHASE(p));
+    if (s.allocs == 0 && s.rss_growth == 0)
+      continue;
+    out << "  " << std::left << std::setw(9) << phase_name(MEMORY_PHASE(p))
+        << std::right << std::setw(10) << s.allocs << std::fixed
+        << std::setprecision(2) << std::setw(10) << s.bytes / MB
+        << std::setw(10) << s.peak_live / MB << std::setw(10)
+        << s.rss_growth / MB << std::defaultfloat << std::endl;
+  }
+  out << "  peak live: " << peak_live() / MB << " MB" << std::endl;
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+CINO_INLINE
+void MemoryProfile::on_alloc(const size_t size) {
+  State &s = state();
+  uint64_t live = s.live.fetch_add(size, std::memory_order_relaxed) + size;
+  atomic_max(s.peak_live, live);
+  Counters &c = s.phases[s.phase.load(std::memory_order_relaxed)];
+  c.allocs.fetch_add(1, std::memory_order_relaxed);
+  c.bytes.fetch_add(size, std::memory_order_relaxed);
+  atomic_max(c.peak_live, live);
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+CINO_INLINE
+void MemoryProfile::on_free(const size_t size) {
+  state().live.fetch_sub(size, std::memory_order_relaxed);
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+CINO_INLINE
+MEMORY_PHASE MemoryProfile::enter(const MEMORY_PHASE phase) {
+  sample_rss();
+  return MEMORY_PHASE(state().phase.exchange(phase));
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+CINO_INLINE
+void MemoryProfile::leave(const MEMORY_PHASE previous) {
+  sample_rss();
+  state().phase = previous;
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+CINO_INLINE
+void MemoryProfile::sample_rss() {
+  State &s = state();
+  uint64_t rss = peak_rss();
+  uint64_t last = s.last_rss.exchange(rss);
+  if (rss > last && last > 0)
+    s.phases[s.phase.load()].rss_growth += rss - last;
+}
+
+} // namespace cinolib
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+#ifdef KERNEL_MEMORY_PROFILE
+// counting replacements of the global allocation functions. Each block is
+// prefixed by its size, so that delete knows how many bytes are released
+static const size_t MEMORY_HEADER = alignof(std::max_align_t);
+
+void *operator new(size_t size) {
+  char *p = (char *)std::malloc(size + MEMORY_HEADER);
+  if (p == nullptr)
+    throw std::bad_alloc();
+  *(size_t *)p = size;
+  cinolib::MemoryProfile::on_alloc(size);
+  return p + MEMORY_HEADER;
+}
+
+void *operator new[](size_t size) { return operator new(size); }
+
+void operator delete(void *ptr) noexcept {
+  if (ptr == nullptr)
+    return;
+  char *p = (char *)ptr - MEMORY_HEADER;
+  cinolib::MemoryProfile::on_free(*(size_t *)p);
+  std::free(p);
+}
+
+void operator delete[](void *ptr) noexcept { operator delete(ptr); }
+void operator delete(void *ptr, size_t) noexcept { operator delete(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { operator delete(ptr); }
+#endif
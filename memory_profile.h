@@ -0,0 +1,138 @@
+#ifndef MEMORY_PROFILE_H
+#define MEMORY_PROFILE_H
+
+// allocation profiling by phase of the kernel computation. When compiled with
+// KERNEL_MEMORY_PROFILE, the global operator new and delete are replaced with
+// counting versions, and every allocation is attributed to the current phase,
+// set by the KERNEL_MEMORY_PHASE scope guards placed in the kernel code. For
+// each phase the profile records the number of allocations, the bytes
+// allocated, the peak of live heap bytes and the growth of the peak resident
+// set size while the phase was current. Without KERNEL_MEMORY_PROFILE the
+// guards compile to nothing and the profile stays empty.
+//
+// The current phase is shared by all threads, so that the chunks run by
+// parallel_chunks are attributed to the phase that started them. With several
+// kernels computed concurrently (e.g. the service workers) phases overlap and
+// the attribution is only indicative. In header-only builds with
+// KERNEL_MEMORY_PROFILE, include this file from a single translation unit,
+// since the replaced allocation functions cannot be inline.
+
+#include <cinolib/cino_inline.h>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+
+namespace cinolib {
+
+enum MEMORY_PHASE {
+  PHASE_OTHER = 0,
+  PHASE_LOAD,     // input mesh, with its normals
+  PHASE_PLANES,   // clipping planes and their acceleration structures
+  PHASE_CLASSIFY, // classification of the kernel vertices
+  PHASE_CLIP,     // clipping of the kernel faces
+  PHASE_CAP,      // cap face construction
+  PHASE_OUTPUT,   // output mesh
+  NUM_MEMORY_PHASES
+};
+
+struct MemoryPhaseStats {
+  uint64_t allocs = 0;    // number of allocations
+  uint64_t bytes = 0;     // bytes allocated
+  uint64_t peak_live = 0; // peak of the live heap bytes
+  uint64_t rss_growth = 0; // growth of the peak resident set size, in bytes
+};
+
+class MemoryProfile {
+
+public:
+  // true if compiled with KERNEL_MEMORY_PROFILE
+  CINO_INLINE
+  static bool enabled();
+
+  CINO_INLINE
+  static const char *phase_name(const MEMORY_PHASE phase);
+
+  CINO_INLINE
+  static MemoryPhaseStats stats(const MEMORY_PHASE phase);
+
+  // peak of the live heap bytes over all phases, since the last reset
+  CINO_INLINE
+  static uint64_t peak_live();
+
+  // clears the statistics (live bytes are kept, and become the new peaks)
+  CINO_INLINE
+  static void reset();
+
+  // one line per phase with allocations: allocations, MB allocated, peak MB
+  // live and MB of resident set growth
+  CINO_INLINE
+  static void print(std::ostream &out);
+
+  // bookkeeping, called by the allocation hooks and by MemoryPhase
+  CINO_INLINE
+  static void on_alloc(const size_t size);
+  CINO_INLINE
+  static void on_free(const size_t size);
+  CINO_INLINE
+  static MEMORY_PHASE enter(const MEMORY_PHASE phase);
+  CINO_INLINE
+  static void leave(const MEMORY_PHASE previous);
+
+private:
+  struct Counters {
+    std::atomic<uint64_t> allocs{0}, bytes{0}, peak_live{0}, rss_growth{0};
+  };
+  struct State {
+    std::atomic<int> phase{PHASE_OTHER};
+    std::atomic<uint64_t> live{0}, peak_live{0};
+    std::atomic<uint64_t> last_rss{0}; // peak RSS at the last phase switch
+    Counters phases[NUM_MEMORY_PHASES];
+  };
+
+  // function local, so that it is usable from the first allocation on
+  CINO_INLINE
+  static State &state();
+
+  // attributes the growth of the peak RSS since the last switch to the
+  // current phase
+  CINO_INLINE
+  static void sample_rss();
+};
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+// sets the current phase for its lifetime
+class MemoryPhase {
+
+public:
+  CINO_INLINE
+  explicit MemoryPhase(const MEMORY_PHASE phase)
+      : previous(MemoryProfile::enter(phase)) {}
+
+  CINO_INLINE
+  ~MemoryPhase() { MemoryProfile::leave(previous); }
+
+  MemoryPhase(const MemoryPhase &) = delete;
+  MemoryPhase &operator=(const MemoryPhase &) = delete;
+
+private:
+  MEMORY_PHASE previous;
+};
+
+} // namespace cinolib
+
+#ifdef KERNEL_MEMORY_PROFILE
+#define KERNEL_MEMORY_CONCAT(a, b) a##b
+#define KERNEL_MEMORY_GUARD(line) KERNEL_MEMORY_CONCAT(kernel_memory_phase, line)
+#define KERNEL_MEMORY_PHASE(phase)                                             \
+  cinolib::MemoryPhase KERNEL_MEMORY_GUARD(__LINE__)(cinolib::phase)
+#else
+#define KERNEL_MEMORY_PHASE(phase)
+#endif
+
+#ifndef CINO_STATIC_LIB
+#include "memory_profile.cpp"
+#endif
+
+#endif // MEMORY_PROFILE_H
@@ -0,0 +1,116 @@
+#ifndef MESH_VIEW_H
+#define MESH_VIEW_H
+
+// read-only views of a polygon mesh, through which PolyhedronKernel reads its
+// input in place. MeshView wraps caller-owned buffers: a coordinate array
+// (float or double, possibly interleaved with other attributes), a flat index
+// buffer with face offsets or a fixed arity, and optional face normals.
+// VectorMeshView wraps the std::vector based input of the other overloads.
+//
+// Both provide num_verts, num_faces, vert(vid), face_size(fid),
+// face_vert(fid, i) and normal(fid), the outward unit normal of face fid.
+// Missing normals are computed on the fly with Newell's method, as done by
+// Polygonmesh
+
+#include <cinolib/geometry/vec_mat.h>
+#include <cstddef>
+#include <vector>
+
+namespace cinolib {
+
+// Newell normal of face fid of mesh, normalized
+template <class M>
+inline vec3d newell_normal(const M &mesh, const uint fid) {
+  vec3d n(0, 0, 0);
+  const uint size = mesh.face_size(fid);
+  for (uint i = 0; i < size; i++) {
+    vec3d a = mesh.vert(mesh.face_vert(fid, i));
+    vec3d b = mesh.vert(mesh.face_vert(fid, (i + 1) % size));
+    n[0] += (a[1] - b[1]) * (a[2] + b[2]);
+    n[1] += (a[2] - b[2]) * (a[0] + b[0]);
+    n[2] += (a[0] - b[0]) * (a[1] + b[1]);
+  }
+  n.normalize();
+  return n;
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+// mesh in caller-owned buffers of scalar type S (float or double). Strides
+// are in bytes, as in GPU vertex layouts
+template <class S> struct MeshView {
+  // vertex vid is at coords + vid * coord_stride bytes
+  const S *coords = nullptr;
+  uint num_verts = 0;
+  size_t coord_stride = 3 * sizeof(S);
+  // face fid is indices[offsets[fid], offsets[fid + 1]), or, without
+  // offsets, indices[fid * arity, (fid + 1) * arity)
+  const uint *indices = nullptr;
+  const uint *offsets = nullptr;
+  uint arity = 3;
+  uint num_faces = 0;
+  // outward unit normal of face fid at normals + fid * normal_stride bytes,
+  // computed when null
+  const S *normals = nullptr;
+  size_t normal_stride = 3 * sizeof(S);
+
+  vec3d vert(const uint vid) const {
+    const S *p = (const S *)((const char *)coords + vid * coord_stride);
+    return vec3d(p[0], p[1], p[2]);
+  }
+
+  uint face_size(const uint fid) const {
+    return offsets ? offsets[fid + 1] - offsets[fid] : arity;
+  }
+
+  uint face_vert(const uint fid, const uint i) const {
+    return indices[offsets ? offsets[fid] + i : size_t(fid) * arity + i];
+  }
+
+  vec3d normal(const uint fid) const {
+    if (normals == nullptr)
+      return newell_normal(*this, fid);
+    const S *n = (const S *)((const char *)normals + fid * normal_stride);
+    return vec3d(n[0], n[1], n[2]);
+  }
+};
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+// mesh in vectors. faces and normals may be null, when only the vertices are
+// read
+template <class T> struct VectorMeshView {
+  const std::vector<mat<3, 1, T>> &verts;
+  const std::vector<std::vector<uint>> *faces;
+  const std::vector<mat<3, 1, T>> *normals;
+  uint num_verts;
+  uint num_faces;
+
+  explicit VectorMeshView(const std::vector<mat<3, 1, T>> &verts,
+                          const std::vector<std::vector<uint>> *faces = nullptr,
+                          const std::vector<mat<3, 1, T>> *normals = nullptr)
+      : verts(verts), faces(faces), normals(normals), num_verts(verts.size()),
+        num_faces(faces ? faces->size() : 0) {}
+
+  vec3d vert(const uint vid) const {
+    const mat<3, 1, T> &v = verts[vid];
+    return vec3d(v.x(), v.y(), v.z());
+  }
+
+  uint face_size(const uint fid) const { return (*faces)[fid].size(); }
+
+  uint face_vert(const uint fid, const uint i) const {
+    return (*faces)[fid][i];
+  }
+
+  vec3d normal(const uint fid) const {
+    if (normals == nullptr)
+      return newell_normal(*this, fid);
+    const mat<3, 1, T> &n = (*normals)[fid];
+    return vec3d(n.x(), n.y(), n.z());
+  }
+};
+
+} // namespace cinolib
+
+#endif // MESH_VIEW_H
@@ -0,0 +1,89 @@
+#include "parallel_chunks.h"
+
+namespace cinolib {
+
+CINO_INLINE
+ChunkPool &ChunkPool::instance() {
+  // never destroyed, so that no worker is joined during static destruction
+  static ChunkPool *pool =
+      new ChunkPool(std::max(1u, std::thread::hardware_concurrency()) - 1);
+  return *pool;
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+CINO_INLINE
+ChunkPool::ChunkPool(const uint n_threads) {
+  for (uint i = 0; i < n_threads; i++)
+    threads.emplace_back([this]() {
+      std::unique_lock<std::mutex> lock(mutex);
+      for (;;) {
+        work.wait(lock, [this]() { return !queue.empty(); });
+        run_one(lock);
+      }
+    });
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+CINO_INLINE
+void ChunkPool::run_one(std::unique_lock<std::mutex> &lock) {
+  std::function<void()> task = std::move(queue.front());
+  queue.pop_front();
+  lock.unlock();
+  task();
+  lock.lock();
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+CINO_INLINE
+void ChunkPool::run(const std::vector<std::function<void()>> &tasks) {
+  if (tasks.empty())
+    return;
+  // guarded by mutex: tasks still queued or running, first exception thrown
+  uint pending = tasks.size() - 1;
+  std::exception_ptr error;
+  auto guarded = [this, &error](const std::function<void()> &task) {
+    try {
+      task();
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (!error)
+        error = std::current_exception();
+    }
+  };
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (uint i = 1; i < tasks.size(); i++)
+      queue.push_back([this, &tasks, &pending, &guarded, i]() {
+        guarded(tasks.at(i));
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--pending == 0)
+          done.notify_all();
+      });
+  }
+  work.notify_all();
+  guarded(tasks.front());
+  std::unique_lock<std::mutex> lock(mutex);
+  while (pending > 0) {
+    if (!queue.empty())
+      run_one(lock);
+    else
+      done.wait(lock);
+  }
+  if (error)
+    std::rethrow_exception(error);
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+CINO_INLINE
+uint num_chunks(const uint n, const uint threshold) {
+  if (n < threshold)
+    return 1;
+  uint n_threads = std::max(1u, std::thread::hardware_concurrency());
+  return std::max(1u, std::min(n, n_threads));
+}
+
+} // namespace cinolib
@@ -0,0 +1,92 @@
+#ifndef PARALLEL_CHUNKS_H
+#define PARALLEL_CHUNKS_H
+
+// minimal fork-join helper: splits the range [0,n) in contiguous chunks, one
+// per thread, so that each thread can fill its own output buffer. Buffers can
+// then be concatenated in chunk order, which makes results independent of the
+// number of threads.
+//
+// Chunks run on a pool of threads shared by the whole process (ChunkPool),
+// so that a clip costs no thread creation, and callers that are parallel
+// themselves (service workers, compute_race) share the same threads instead
+// of each spawning its own.
+
+#include <cinolib/cino_inline.h>
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace cinolib {
+
+// pool of hardware threads - 1 workers (the caller runs a chunk itself),
+// started on first use and never stopped. A caller waiting for its chunks
+// runs queued chunks meanwhile, its own or those of other callers, so that
+// concurrent callers make progress even when all the workers are busy. The
+// pool is not fork safe: processes are forked before its first use (see
+// batch_runner.h)
+class ChunkPool {
+
+public:
+  CINO_INLINE
+  static ChunkPool &instance();
+
+  // runs tasks.at(0) on the calling thread and the others on the pool, and
+  // returns when all of them are done. The first exception thrown by a task
+  // is rethrown here
+  CINO_INLINE
+  void run(const std::vector<std::function<void()>> &tasks);
+
+private:
+  CINO_INLINE
+  explicit ChunkPool(const uint n_threads);
+
+  // pops and runs the first queued task, with the mutex held by lock
+  // (released while the task runs)
+  CINO_INLINE
+  void run_one(std::unique_lock<std::mutex> &lock);
+
+  std::mutex mutex;
+  std::condition_variable work; // a task was queued
+  std::condition_variable done; // a task was completed
+  std::deque<std::function<void()>> queue;
+  std::vector<std::thread> threads;
+};
+
+// number of chunks to use for n items: 1 (serial) below the threshold, the
+// number of hardware threads otherwise
+CINO_INLINE
+uint num_chunks(const uint n, const uint threshold);
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+// calls func(chunk, begin, end) for each of the n_chunks chunks of [0,n), the
+// first one on the calling thread and the others on the ChunkPool
+template <class Func>
+CINO_INLINE void parallel_chunks(const uint n, const uint n_chunks,
+                                 const Func &func) {
+  if (n_chunks <= 1) {
+    func(0, 0, n);
+    return;
+  }
+  std::vector<std::function<void()>> tasks;
+  tasks.reserve(n_chunks);
+  for (uint c = 0; c < n_chunks; c++)
+    tasks.push_back([&func, c, n, n_chunks]() {
+      func(c, uint(uint64_t(c) * n / n_chunks),
+           uint(uint64_t(c + 1) * n / n_chunks));
+    });
+  ChunkPool::instance().run(tasks);
+}
+
+} // namespace cinolib
+
+#ifndef CINO_STATIC_LIB
+#include "parallel_chunks.cpp"
+#endif
+
+#endif // PARALLEL_CHUNKS_H
@@ -0,0 +1,135 @@
+#include "plane_hierarchy.h"
+#include <algorithm>
+#include <cmath>
+
+namespace cinolib {
+
+CINO_INLINE
+void PlaneHierarchy::build(const std::vector<vec3d> &verts,
+                           const std::vector<std::vector<uint>> &faces,
+                           const std::vector<vec3d> &normals,
+                           const uint leaf_size) {
+  vec3d min(inf_double, inf_double, inf_double);
+  vec3d max(-inf_double, -inf_double, -inf_double);
+  for (const vec3d &v : verts) {
+    min = min.min(v);
+    max = max.max(v);
+  }
+  std::vector<vec3d> points(faces.size(), vec3d(NAN, NAN, NAN));
+  for (uint fid = 0; fid < faces.size(); fid++)
+    if (!faces.at(fid).empty())
+      points.at(fid) = verts.at(faces.at(fid).front());
+  build(points, normals, min.dist(max), leaf_size);
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+CINO_INLINE
+void PlaneHierarchy::build(const std::vector<vec3d> &points,
+                           const std::vector<vec3d> &normals,
+                           const double diag, const uint leaf_size) {
+  nodes.clear();
+  faces_ids.clear();
+  this->leaf_size = std::max(1u, leaf_size);
+  this->diag = diag;
+  m.resize(points.size());
+  p.resize(points.size());
+  for (uint fid = 0; fid < points.size(); fid++) {
+    if (points.at(fid).is_nan() || points.at(fid).is_inf() ||
+        normals.at(fid).is_deg())
+      continue;
+    m.at(fid) = -normals.at(fid);
+    p.at(fid) = points.at(fid);
+    faces_ids.push_back(fid);
+  }
+  if (!faces_ids.empty())
+    add_node(0, faces_ids.size());
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+CINO_INLINE
+int PlaneHierarchy::add_node(const uint begin, const uint end) {
+  Node node;
+  node.begin = begin;
+  node.end = end;
+  node.axis = vec3d(0, 0, 0);
+  node.q = vec3d(0, 0, 0);
+  for (uint i = begin; i < end; i++) {
+    node.axis += m[faces_ids[i]];
+    node.q += p[faces_ids[i]];
+  }
+  node.q /= double(end - begin);
+  node.cos_angle = -1; // normals cancel out
+  if (node.axis.normalize() >= 1e-12) {
+    node.cos_angle = 1;
+    for (uint i = begin; i < end; i++) {
+      double cos = node.axis.dot(m[faces_ids[i]]);
+      node.cos_angle = std::max(-1.0, std::min(node.cos_angle, cos));
+    }
+  }
+  node.sin_angle = std::sqrt(1 - node.cos_angle * node.cos_angle);
+  node.lo = inf_double;
+  for (uint i = begin; i < end; i++) {
+    uint fid = faces_ids[i];
+    node.lo = std::min(node.lo, m[fid].dot(node.q - p[fid]));
+  }
+  nodes.push_back(node);
+  return nodes.size() - 1;
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+CINO_INLINE
+bool PlaneHierarchy::split(const int id) {
+  if (nodes.at(id).left >= 0)
+    return true;
+  const uint begin = nodes.at(id).begin, end = nodes.at(id).end;
+  if (end - begin <= leaf_size)
+    return false;
+  auto key = [&](uint fid, uint k) {
+    return k < 3 ? m[fid][k] * diag : p[fid][k - 3];
+  };
+  double lo[6], hi[6];
+  std::fill(lo, lo + 6, inf_double);
+  std::fill(hi, hi + 6, -inf_double);
+  for (uint i = begin; i < end; i++)
+    for (uint k = 0; k < 6; k++) {
+      lo[k] = std::min(lo[k], key(faces_ids[i], k));
+      hi[k] = std::max(hi[k], key(faces_ids[i], k));
+    }
+  uint best_k = 0;
+  for (uint k = 1; k < 6; k++)
+    if (hi[k] - lo[k] > hi[best_k] - lo[best_k])
+      best_k = k;
+  uint mid = (begin + end) / 2;
+  std::nth_element(faces_ids.begin() + begin, faces_ids.begin() + mid,
+                   faces_ids.begin() + end, [&](uint a, uint b) {
+                     return key(a, best_k) < key(b, best_k);
+                   });
+  int left = add_node(begin, mid);
+  int right = add_node(mid, end);
+  nodes.at(id).left = left;
+  nodes.at(id).right = right;
+  return true;
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+CINO_INLINE
+double PlaneHierarchy::depth(const Node &node, const vec3d &c) const {
+  // m.v is bounded from below, over the unit vectors m in the cone, by
+  // |v| cos(phi + angle), phi being the angle between the axis and v
+  vec3d v = c - node.q;
+  double len = v.norm();
+  if (len == 0)
+    return node.lo;
+  double cos_phi = std::max(-1.0, std::min(1.0, node.axis.dot(v) / len));
+  if (cos_phi <= -node.cos_angle) // phi + angle >= pi
+    return node.lo - len;
+  double sin_phi = std::sqrt(1 - cos_phi * cos_phi);
+  return node.lo +
+         len * (cos_phi * node.cos_angle - sin_phi * node.sin_angle);
+}
+
+} // namespace cinolib
@@ -0,0 +1,79 @@
+#ifndef PLANE_HIERARCHY_H
+#define PLANE_HIERARCHY_H
+
+// bounding hierarchy over the face planes of a mesh, used to skip whole groups
+// of planes that cannot cut the kernel. Each node bounds the inward normals
+// m_i = -n_i of its faces with a cone (axis, half angle) and their offsets
+// wrt a reference point q with lo = min_i m_i.(q - p_i), p_i being a point of
+// face i. For a point c, m_i.(c - p_i) = m_i.(c - q) + m_i.(q - p_i), and the
+// first term is bounded from below by the cone, so a single test proves that
+// c lies inside every half-space of the node.
+//
+// Nodes are split lazily, the first time they are visited, so that the parts
+// of the mesh far from the kernel are never refined
+
+#include <cinolib/cino_inline.h>
+#include <cinolib/geometry/vec_mat.h>
+#include <cinolib/min_max_inf.h>
+#include <vector>
+
+namespace cinolib {
+
+class PlaneHierarchy {
+
+public:
+  struct Node {
+    vec3d axis;       // cone axis (unit)
+    double cos_angle; // cosine and sine of the cone half angle, in [0, pi]
+    double sin_angle;
+    vec3d q;          // reference point
+    double lo;        // min over the faces of m_i.(q - p_i)
+    uint begin, end;  // faces faces_ids[begin, end)
+    int left = -1;    // children, -1 for leaves and nodes not split yet
+    int right = -1;
+  };
+
+  std::vector<Node> nodes;     // nodes.front() is the root
+  std::vector<uint> faces_ids; // faces, in leaf order
+
+  // creates the root. Degenerate faces are left out
+  CINO_INLINE
+  void build(const std::vector<vec3d> &verts,
+             const std::vector<std::vector<uint>> &faces,
+             const std::vector<vec3d> &normals, const uint leaf_size = 8);
+
+  // as above, from a point and the outward normal of each face (faces with a
+  // non finite point or a degenerate normal are left out) and the diagonal of
+  // the mesh bounding box
+  CINO_INLINE
+  void build(const std::vector<vec3d> &points,
+             const std::vector<vec3d> &normals, const double diag,
+             const uint leaf_size = 8);
+
+  // splits the node at the median of the coordinate (of normal times the
+  // bounding box diagonal, or of position) with the largest extent, unless it
+  // has at most leaf_size faces. Returns false for leaves
+  CINO_INLINE
+  bool split(const int id);
+
+  // lower bound of the signed distance of c from the planes of the faces of
+  // node, positive inside: the ball (c, r) is inside all of them if it is > r
+  CINO_INLINE
+  double depth(const Node &node, const vec3d &c) const;
+
+private:
+  std::vector<vec3d> m, p; // inward normals and face points, by face
+  double diag = 0;
+  uint leaf_size = 8;
+
+  CINO_INLINE
+  int add_node(const uint begin, const uint end);
+};
+
+} // namespace cinolib
+
+#ifndef CINO_STATIC_LIB
+#include "plane_hierarchy.cpp"
+#endif
+
+#endif // PLANE_HIERARCHY_H
@@ -2,161 +2,2173 @@
 
 using namespace cinolib;
 
+template <class T>
 CINO_INLINE
-void PolyhedronKernel::initialize(const std::vector<vec3d> &verts) {
+void PolyhedronKernel<T>::initialize(const std::vector<vec> &verts,
+                                     const SEED_TYPE &seed) {
+  initialize_mesh(VectorMeshView<T>(verts), seed);
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+template <class T>
+template <class S>
+CINO_INLINE void PolyhedronKernel<T>::initialize(const MeshView<S> &mesh,
+                                                 const SEED_TYPE &seed) {
+  initialize_mesh(mesh, seed);
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+template <class T>
+template <class M>
+CINO_INLINE void PolyhedronKernel<T>::initialize_mesh(const M &mesh,
+                                                      const SEED_TYPE &seed) {
   // initialize the kernel with the polyhedron AABB
-  if (verts.empty())
+  if (mesh.num_verts == 0)
     return;
-  vec3d min(inf_double, inf_double, inf_double);
-  vec3d max(-inf_double, -inf_double, -inf_double);
-  for (const vec3d &p : verts) {
-    min = min.min(p);
-    max = max.max(p);
+  vec min(INF, INF, INF);
+  vec max(-INF, -INF, -INF);
+  for (uint vid = 0; vid < mesh.num_verts; vid++) {
+    min = min.min(to_vec(mesh.vert(vid)));
+    max = max.max(to_vec(mesh.vert(vid)));
   }
   kernel_verts = {min,
-                  vec3d(min.x(), max.y(), min.z()),
-                  vec3d(max.x(), max.y(), min.z()),
-                  vec3d(max.x(), min.y(), min.z()),
-                  vec3d(min.x(), min.y(), max.z()),
-                  vec3d(min.x(), max.y(), max.z()),
+                  vec(min.x(), max.y(), min.z()),
+                  vec(max.x(), max.y(), min.z()),
+                  vec(max.x(), min.y(), min.z()),
+                  vec(min.x(), min.y(), max.z()),
+                  vec(min.x(), max.y(), max.z()),
                   max,
-                  vec3d(max.x(), min.y(), max.z())};
+                  vec(max.x(), min.y(), max.z())};
   kernel_faces = {{0, 1, 2, 3}, {2, 1, 5, 6}, {3, 2, 6, 7},
                   {0, 3, 7, 4}, {1, 0, 4, 5}, {5, 4, 7, 6}};
+  kernel_face_planes.assign(kernel_faces.size(), -1);
+  if (seed == SEED_AABB)
+    return;
+
+  // oriented bounding box along the principal axes of the vertices, used only
+  // if its volume is smaller than the AABB one
+  vec3d c(0, 0, 0);
+  for (uint vid = 0; vid < mesh.num_verts; vid++)
+    c += to_vec3d(to_vec(mesh.vert(vid)));
+  c /= static_cast<double>(mesh.num_verts);
+  double C[3][3] = {{0, 0, 0}, {0, 0, 0}, {0, 0, 0}};
+  for (uint vid = 0; vid < mesh.num_verts; vid++) {
+    const vec p = to_vec(mesh.vert(vid));
+    for (uint i = 0; i < 3; i++)
+      for (uint j = 0; j < 3; j++)
+        C[i][j] += (p[i] - c[i]) * (p[j] - c[j]);
+  }
+  vec3d e[3];
+  principal_axes(C, e);
+  e[2] = e[0].cross(e[1]); // right-handed frame, to keep faces orientation
+  vec3d lo(inf_double, inf_double, inf_double);
+  vec3d hi(-inf_double, -inf_double, -inf_double);
+  for (uint vid = 0; vid < mesh.num_verts; vid++) {
+    vec3d d = to_vec3d(to_vec(mesh.vert(vid))) - c;
+    vec3d q(e[0].dot(d), e[1].dot(d), e[2].dot(d));
+    lo = lo.min(q);
+    hi = hi.max(q);
+  }
+  vec3d aabb = to_vec3d(max - min), obb = hi - lo;
+  if (obb.x() * obb.y() * obb.z() >= aabb.x() * aabb.y() * aabb.z())
+    return;
+  auto corner = [&](double x, double y, double z) {
+    vec3d p = c + e[0] * x + e[1] * y + e[2] * z;
+    return vec(p.x(), p.y(), p.z());
+  };
+  kernel_verts = {corner(lo.x(), lo.y(), lo.z()),
+                  corner(lo.x(), hi.y(), lo.z()),
+                  corner(hi.x(), hi.y(), lo.z()),
+                  corner(hi.x(), lo.y(), lo.z()),
+                  corner(lo.x(), lo.y(), hi.z()),
+                  corner(lo.x(), hi.y(), hi.z()),
+                  corner(hi.x(), hi.y(), hi.z()),
+                  corner(hi.x(), lo.y(), hi.z())};
 }
 
 //::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
 
+template <class T>
 CINO_INLINE
-void PolyhedronKernel::compute(const std::vector<vec3d> &verts,
-                               const std::vector<std::vector<uint>> &faces,
-                               const std::vector<vec3d> &normals,
-                               const bool &shuffle) {
-  if (kernel_verts.empty() || kernel_faces.empty()) {
-    std::cout << "ERROR: initialize kernel before computing." << std::endl;
-    return;
+bool PolyhedronKernel<T>::is_convex(const std::vector<vec> &verts,
+                                    const std::vector<std::vector<uint>> &faces,
+                                    const std::vector<vec> &normals) const {
+  return is_convex_mesh(VectorMeshView<T>(verts, &faces, &normals));
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+template <class T>
+template <class M>
+CINO_INLINE bool PolyhedronKernel<T>::is_convex_mesh(const M &mesh) const {
+  // a closed, connected, consistently oriented surface is convex iff it is
+  // locally convex at each edge: the faces adjacent to f along an edge must
+  // lie below the plane of f. Each edge is tested as soon as its twin is
+  // found, so that most non-convex meshes are rejected early
+  const uint num_faces = mesh.num_faces;
+  if (num_faces == 0)
+    return false;
+  auto below = [&](const uint fid, const uint adj) {
+    const vec n = to_vec(mesh.normal(fid));
+    const vec p = to_vec(mesh.vert(mesh.face_vert(fid, 0)));
+    for (uint j = 0; j < mesh.face_size(adj); j++)
+      if (n.dot(to_vec(mesh.vert(mesh.face_vert(adj, j))) - p) > TOLL)
+        return false;
+    return true;
+  };
+  std::vector<uint> component(num_faces);
+  std::iota(component.begin(), component.end(), 0);
+  auto root = [&](uint fid) {
+    while (component.at(fid) != fid)
+      fid = component.at(fid) = component.at(component.at(fid));
+    return fid;
+  };
+  std::unordered_map<uint64_t, uint> edge_face; // directed edge -> face
+  uint64_t unmatched = 0; // edges whose twin was not found yet
+  for (uint fid = 0; fid < num_faces; fid++) {
+    const uint size = mesh.face_size(fid);
+    if (size < 3 || mesh.normal(fid).is_deg())
+      return false;
+    for (uint i = 0; i < size; i++) {
+      const uint a = mesh.face_vert(fid, i);
+      const uint b = mesh.face_vert(fid, (i + 1) % size);
+      if (a == b)
+        return false; // degenerate edge
+      if (!edge_face.emplace((uint64_t(a) << 32) | b, fid).second)
+        return false; // non-manifold or inconsistently oriented
+      auto it = edge_face.find((uint64_t(b) << 32) | a);
+      if (it == edge_face.end()) {
+        unmatched++;
+        continue;
+      }
+      const uint adj = it->second;
+      if (!below(fid, adj) || !below(adj, fid))
+        return false; // concave edge
+      component.at(root(fid)) = root(adj);
+      unmatched--;
+    }
   }
-  std::vector<uint> faces_ids(faces.size());
-  std::iota(faces_ids.begin(), faces_ids.end(), 0);
+  if (unmatched > 0)
+    return false; // open boundary
+  for (uint fid = 0; fid < num_faces; fid++)
+    if (root(fid) != root(0))
+      return false;
+  return true;
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+template <class T>
+CINO_INLINE
+void PolyhedronKernel<T>::compute(const std::vector<vec> &verts,
+                                  const std::vector<std::vector<uint>> &faces,
+                                  const std::vector<vec> &normals,
+                                  const bool &shuffle, KernelMetrics *metrics,
+                                  const ComputeBudget *budget) {
+  std::vector<uint> order;
   if (shuffle) { // optional shuffle mode
     std::random_device rd;
-    std::mt19937 g(rd());
+    order = plane_order(verts, faces, normals, ORDER_RANDOM, rd());
+  }
+  compute_mesh(VectorMeshView<T>(verts, &faces, &normals),
+               shuffle ? &order : nullptr, metrics, budget);
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+template <class T>
+template <class S>
+CINO_INLINE void PolyhedronKernel<T>::compute(const MeshView<S> &mesh,
+                                              KernelMetrics *metrics,
+                                              const ComputeBudget *budget) {
+  compute_mesh(mesh, nullptr, metrics, budget);
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+template <class T>
+CINO_INLINE
+void PolyhedronKernel<T>::compute_ordered(
+    const std::vector<vec> &verts, const std::vector<std::vector<uint>> &faces,
+    const std::vector<vec> &normals, const std::vector<uint> &order,
+    KernelMetrics *metrics, const ComputeBudget *budget) {
+  compute_mesh(VectorMeshView<T>(verts, &faces, &normals), &order, metrics,
+               budget);
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+template <class T>
+CINO_INLINE
+const char *PolyhedronKernel<T>::order_name(const PLANE_ORDER order) {
+  switch (order) {
+  case ORDER_RANDOM:
+    return "random";
+  case ORDER_FARTHEST:
+    return "farthest-first";
+  case ORDER_NORMAL_SPREAD:
+    return "normal-spread";
+  default:
+    return "input";
+  }
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+// farthest-first traversal of points: each point picked is the farthest from
+// those picked before. After max_picks picks, the rest follow by decreasing
+// distance from the picked set, which keeps the cost at O(n * max_picks).
+// Points with NaN coordinates go last
+CINO_INLINE
+static std::vector<uint> farthest_first(const std::vector<vec3d> &points,
+                                        const uint max_picks) {
+  const uint n = points.size();
+  std::vector<uint> order;
+  std::vector<double> dist(n, inf_double);
+  std::vector<bool> picked(n, false);
+  for (uint vid = 0; vid < n; vid++)
+    if (points.at(vid).is_nan())
+      dist.at(vid) = -1;
+  uint next = 0;
+  while (order.size() < std::min(n, max_picks) && dist.at(next) >= 0) {
+    order.push_back(next);
+    picked.at(next) = true;
+    uint best = next;
+    double best_dist = -1;
+    for (uint vid = 0; vid < n; vid++) {
+      if (picked.at(vid) || dist.at(vid) < 0)
+        continue;
+      dist.at(vid) = std::min(dist.at(vid), points.at(vid).dist(points.at(next)));
+      if (dist.at(vid) > best_dist) {
+        best = vid;
+        best_dist = dist.at(vid);
+      }
+    }
+    if (best == next)
+      break;
+    next = best;
+  }
+  std::vector<uint> rest;
+  for (uint vid = 0; vid < n; vid++)
+    if (!picked.at(vid))
+      rest.push_back(vid);
+  std::stable_sort(rest.begin(), rest.end(), [&](uint a, uint b) {
+    return dist.at(a) > dist.at(b);
+  });
+  order.insert(order.end(), rest.begin(), rest.end());
+  return order;
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+template <class T>
+CINO_INLINE
+std::vector<uint> PolyhedronKernel<T>::plane_order(
+    const std::vector<vec> &verts, const std::vector<std::vector<uint>> &faces,
+    const std::vector<vec> &normals, const PLANE_ORDER order,
+    const uint seed) {
+  std::vector<uint> faces_ids(faces.size());
+  std::iota(faces_ids.begin(), faces_ids.end(), 0);
+  if (order == ORDER_RANDOM) {
+    std::mt19937 g(seed);
     std::shuffle(faces_ids.begin(), faces_ids.end(), g);
+  } else if (order == ORDER_FARTHEST || order == ORDER_NORMAL_SPREAD) {
+    // face centroids, or unit normals as points on the sphere
+    std::vector<vec3d> points(faces.size(), vec3d(NAN, NAN, NAN));
+    for (uint fid = 0; fid < faces.size(); fid++) {
+      const std::vector<uint> &f = faces.at(fid);
+      if (f.empty() || normals.at(fid).is_deg())
+        continue;
+      if (order == ORDER_NORMAL_SPREAD) {
+        points.at(fid) = to_vec3d(normals.at(fid));
+        continue;
+      }
+      points.at(fid) = vec3d(0, 0, 0);
+      for (uint vid : f)
+        points.at(fid) += to_vec3d(verts.at(vid));
+      points.at(fid) /= double(f.size());
+    }
+    faces_ids = farthest_first(points, race_max_picks);
   }
+  return faces_ids;
+}
 
-  for (uint fid : faces_ids) {
-    std::vector<uint> f = faces.at(fid);
-    std::vector<vec3d> v(f.size());
-    for (uint vid = 0; vid < f.size(); vid++)
-      v.at(vid) = verts.at(f.at(vid));
-    if (f.size() == 0 || v.front().is_nan() || v.front().is_inf() ||
-        normals.at(fid).is_deg()) {
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+template <class T>
+CINO_INLINE
+typename PolyhedronKernel<T>::PLANE_ORDER PolyhedronKernel<T>::compute_race(
+    const std::vector<vec> &verts, const std::vector<std::vector<uint>> &faces,
+    const std::vector<vec> &normals, const uint seed, KernelMetrics *metrics,
+    const ComputeBudget *budget) {
+  const PLANE_ORDER orders[] = {ORDER_INPUT, ORDER_RANDOM, ORDER_FARTHEST,
+                                ORDER_NORMAL_SPREAD};
+  const uint n = 4;
+  // racers share a budget, cancelled by the first one to finish. The
+  // caller's budget is checked after each plane, through progress
+  ComputeBudget race;
+  if (budget) {
+    race.deadline = budget->deadline;
+    race.progress = [&](uint, uint) {
+      if (budget->expired())
+        race.cancel = true;
+    };
+  }
+  std::vector<PolyhedronKernel<T>> racers(n, *this);
+  std::vector<KernelMetrics> racers_metrics(n);
+  std::atomic<int> winner{-1};
+  // the first exception of a racer, or of starting one (e.g. std::bad_alloc,
+  // or std::system_error for a thread beyond the memory limit), cancels the
+  // race and is rethrown once all the racers are joined
+  std::mutex error_mutex;
+  std::exception_ptr error;
+  auto fail = [&]() {
+    std::lock_guard<std::mutex> lock(error_mutex);
+    if (!error)
+      error = std::current_exception();
+    race.cancel = true;
+  };
+  std::vector<std::thread> threads;
+  try {
+    for (uint i = 0; i < n; i++)
+      threads.emplace_back([&, i]() {
+        try {
+          std::vector<uint> order =
+              plane_order(verts, faces, normals, orders[i], seed);
+          racers.at(i).compute_ordered(verts, faces, normals, order,
+                                       &racers_metrics.at(i), &race);
+          int none = -1;
+          if (racers.at(i).num_unapplied == 0 &&
+              winner.compare_exchange_strong(none, i))
+            race.cancel = true;
+        } catch (...) {
+          fail();
+        }
+      });
+  } catch (...) {
+    fail();
+  }
+  for (std::thread &t : threads)
+    t.join();
+  if (error)
+    std::rethrow_exception(error);
+  // without a finisher (the caller's budget expired), the partial kernel
+  // with the fewest planes left is kept
+  int best = winner.load();
+  if (best < 0) {
+    best = 0;
+    for (uint i = 1; i < n; i++)
+      if (racers.at(i).num_unapplied < racers.at(best).num_unapplied)
+        best = i;
+  }
+  *this = std::move(racers.at(best));
+  if (metrics)
+    *metrics = racers_metrics.at(best);
+  return orders[best];
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+template <class T>
+template <class M>
+CINO_INLINE bool PolyhedronKernel<T>::start_compute(const M &mesh,
+                                                    KernelMetrics *metrics) {
+  if (kernel_verts.empty() || kernel_faces.empty()) {
+    std::cout << "ERROR: initialize kernel before computing." << std::endl;
+    return false;
+  }
+  num_clips = 0;
+  num_unapplied = 0;
+  num_simplified_verts = 0;
+  num_simplified_faces = 0;
+  cut_planes.clear();
+  kernel_half_spaces.clear();
+  if (is_convex_mesh(mesh)) { // the mesh is its own kernel
+    // only the vertices of the faces, renumbered
+    const uint NONE = std::numeric_limits<uint>::max();
+    std::vector<uint> new_vid(mesh.num_verts, NONE);
+    kernel_verts.clear();
+    kernel_faces.resize(mesh.num_faces);
+    for (uint fid = 0; fid < mesh.num_faces; fid++) {
+      kernel_faces.at(fid).resize(mesh.face_size(fid));
+      for (uint i = 0; i < mesh.face_size(fid); i++) {
+        uint &vid = new_vid.at(mesh.face_vert(fid, i));
+        if (vid == NONE) {
+          vid = kernel_verts.size();
+          kernel_verts.push_back(to_vec(mesh.vert(mesh.face_vert(fid, i))));
+        }
+        kernel_faces.at(fid).at(i) = vid;
+      }
+    }
+    kernel_face_planes.resize(mesh.num_faces);
+    std::iota(kernel_face_planes.begin(), kernel_face_planes.end(), 0);
+    if (output_half_spaces) { // the planes used by clip
+      for (uint fid = 0; fid < mesh.num_faces; fid++) {
+        KernelHalfSpace &h = cut_planes[fid];
+        h.face_id = fid;
+        h.normal = mesh.normal(fid);
+        h.offset = h.normal.dot(mesh.vert(mesh.face_vert(fid, 0)));
+      }
+      collect_half_spaces();
+    }
+    if (metrics)
+      *metrics = compute_metrics();
+    return false;
+  }
+  if (lazy_faces)
+    to_incidence();
+  return true;
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+template <class T>
+CINO_INLINE
+void PolyhedronKernel<T>::finish_compute(KernelMetrics *metrics) {
+  if (lazy_faces)
+    assemble_faces();
+  if (output_half_spaces)
+    collect_half_spaces();
+  if (metrics)
+    *metrics = compute_metrics();
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+template <class T>
+template <class M>
+CINO_INLINE void PolyhedronKernel<T>::compute_mesh(
+    const M &mesh, const std::vector<uint> *order, KernelMetrics *metrics,
+    const ComputeBudget *budget, std::vector<bool> *cuts) {
+  KERNEL_MEMORY_PHASE(PHASE_PLANES);
+  if (!start_compute(mesh, metrics))
+    return;
+  if (!order && mesh.num_faces >= hierarchy_threshold) {
+    clip_hierarchy(mesh, budget);
+    finish_compute(metrics);
+    return;
+  }
+  std::vector<uint> faces_ids(mesh.num_faces);
+  if (order)
+    faces_ids = *order;
+  else
+    std::iota(faces_ids.begin(), faces_ids.end(), 0);
+
+  // AABB of the kernel (centre o, half sizes h), updated after each cut
+  vec o(0, 0, 0), h(0, 0, 0);
+  auto update_box = [&]() {
+    vec min(INF, INF, INF);
+    vec max(-INF, -INF, -INF);
+    for (const vec &p : kernel_verts) {
+      min = min.min(p);
+      max = max.max(p);
+    }
+    o = (min + max) * 0.5;
+    h = (max - min) * 0.5;
+  };
+  if (cuts)
+    update_box();
+
+  // triangle and quad meshes take the fixed-size path
+  const uint arity = uniform_arity(mesh);
+  for (uint i = 0; i < faces_ids.size(); i++) {
+    if (budget && budget->expired()) {
+      num_unapplied = faces_ids.size() - i;
+      break;
+    }
+    if (budget && budget->progress && i > 0)
+      budget->progress(i, faces_ids.size());
+    uint fid = faces_ids.at(i);
+    if (cuts && mesh.face_size(fid) > 0) {
+      // the kernel lies below the face: skip it if the whole box does too
+      const vec n = to_vec(mesh.normal(fid));
+      if (n.dot(o - to_vec(mesh.vert(mesh.face_vert(fid, 0)))) +
+              fabs(n.x()) * h.x() + fabs(n.y()) * h.y() +
+              fabs(n.z()) * h.z() <
+          -TOLL)
+        continue;
+    }
+    uint clips = num_clips;
+    if (!(arity == 3   ? clip_face<3>(mesh, fid)
+          : arity == 4 ? clip_face<4>(mesh, fid)
+                       : clip_face<0>(mesh, fid)))
+      break;
+    if (simplify_interval > 0 && num_clips > clips &&
+        num_clips % simplify_interval == 0)
+      simplify();
+    if (cuts && num_clips > clips) {
+      cuts->at(fid) = true;
+      update_box();
+    }
+  }
+  if (budget && budget->progress && num_unapplied == 0)
+    budget->progress(faces_ids.size(), faces_ids.size());
+  finish_compute(metrics);
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+template <class T>
+CINO_INLINE
+void PolyhedronKernel<T>::compute_randomized(
+    const std::vector<vec> &verts, const std::vector<std::vector<uint>> &faces,
+    const std::vector<vec> &normals, const uint seed, KernelMetrics *metrics,
+    const ComputeBudget *budget) {
+  KERNEL_MEMORY_PHASE(PHASE_PLANES);
+  const VectorMeshView<T> mesh(verts, &faces, &normals);
+  if (!start_compute(mesh, metrics))
+    return;
+  // a vertex conflicts with a plane if it is not strictly below it: vertices
+  // on the plane are kept as witnesses, clip decides whether they are cut
+  auto conflict = [&](const uint fid, const vec &x) {
+    const vec &n = normals.at(fid);
+    return n.dot(x - verts.at(faces.at(fid).front())) > -TOLL * n.norm();
+  };
+
+  std::vector<uint> order;
+  std::vector<bool> pending(faces.size(), false);
+  std::vector<std::vector<uint>> witnessed(kernel_verts.size());
+  for (uint fid = 0; fid < faces.size(); fid++) {
+    const std::vector<uint> &f = faces.at(fid);
+    if (f.size() == 0 || verts.at(f.front()).is_nan() ||
+        verts.at(f.front()).is_inf() || normals.at(fid).is_deg()) {
       std::cout << "WARNING: skipping degenerate face." << std::endl;
       continue;
     }
-    ExtendedPlane plane(v.front(), -normals.at(fid));
+    for (uint vid = 0; vid < kernel_verts.size(); vid++)
+      if (conflict(fid, kernel_verts.at(vid))) {
+        witnessed.at(vid).push_back(fid);
+        pending.at(fid) = true;
+        order.push_back(fid);
+        break;
+      }
+  }
+  std::mt19937 g(seed);
+  std::shuffle(order.begin(), order.end(), g);
 
-    std::vector<INTERSECTION_TYPE> v_sign(kernel_verts.size());
-    for (uint vid = 0; vid < kernel_verts.size(); vid++) {
-      if (find_v(v.begin(), v.end(), kernel_verts.at(vid)) != v.cend())
-        v_sign.at(vid) = INTERSECT;
+  // after a cut or a simplification (see clip_new_vid), the kept vertices
+  // keep their planes, and the planes of the others look for a new witness
+  // among the vertices in cap
+  auto move_witnesses = [&](const std::vector<uint> &cap) {
+    std::vector<std::vector<uint>> next(kernel_verts.size());
+    std::vector<uint> orphans;
+    for (uint vid = 0; vid < witnessed.size(); vid++) {
+      uint new_vid = clip_new_vid.at(vid);
+      std::vector<uint> &planes = witnessed.at(vid);
+      if (new_vid < next.size())
+        next.at(new_vid).insert(next.at(new_vid).end(), planes.begin(),
+                                planes.end());
+      else
+        orphans.insert(orphans.end(), planes.begin(), planes.end());
+    }
+    for (uint pid : orphans) {
+      if (!pending.at(pid))
+        continue;
+      auto it = std::find_if(cap.begin(), cap.end(), [&](uint vid) {
+        return conflict(pid, kernel_verts.at(vid));
+      });
+      if (it == cap.end())
+        pending.at(pid) = false; // the kernel is inside the plane
       else
-        v_sign.at(vid) = contains(plane, kernel_verts.at(vid));
+        next.at(*it).push_back(pid);
     }
-    polyhedron_plane_intersection(kernel_verts, v_sign, kernel_faces, plane);
-    if (kernel_verts.size() < 3 || kernel_faces.size() < 3) {
-      kernel_verts.clear();
-      kernel_faces.clear();
+    witnessed = std::move(next);
+  };
+
+  std::vector<uint> cap;
+  for (uint i = 0; i < order.size(); i++) {
+    if (budget && budget->expired()) {
+      num_unapplied = std::count_if(order.begin() + i, order.end(),
+                                    [&](uint fid) { return pending.at(fid); });
+      break;
+    }
+    if (budget && budget->progress && i > 0)
+      budget->progress(i, order.size());
+    const uint fid = order.at(i);
+    if (!pending.at(fid)) // no kernel vertex outside the plane
+      continue;
+    pending.at(fid) = false;
+    uint clips = num_clips;
+    if (!clip_face<0>(mesh, fid))
+      break;
+    if (num_clips == clips)
+      continue;
+    // the vertices of the cap face, on the new plane
+    cap.clear();
+    if (!kernel_incidence.empty()) {
+      const uint h = incidence_planes.size() - 1;
+      if (incidence_planes.back() == int(fid))
+        for (uint vid = 0; vid < kernel_incidence.size(); vid++)
+          if (!kernel_incidence.at(vid).empty() &&
+              kernel_incidence.at(vid).back() == h)
+            cap.push_back(vid);
+    } else if (kernel_face_planes.back() == int(fid))
+      cap = kernel_faces.back();
+    if (cap.empty()) { // no cap face (degenerate cut): try all the vertices
+      cap.resize(kernel_verts.size());
+      std::iota(cap.begin(), cap.end(), 0);
+    }
+    move_witnesses(cap);
+    if (simplify_interval > 0 && num_clips % simplify_interval == 0 &&
+        kernel_incidence.empty()) {
+      simplify(); // may remove any vertex
+      cap.resize(kernel_verts.size());
+      std::iota(cap.begin(), cap.end(), 0);
+      move_witnesses(cap);
+    }
+  }
+  if (budget && budget->progress && num_unapplied == 0)
+    budget->progress(order.size(), order.size());
+  finish_compute(metrics);
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+template <class T>
+template <class M>
+CINO_INLINE void PolyhedronKernel<T>::clip_hierarchy(
+    const M &mesh, const ComputeBudget *budget) {
+  // a point and the normal of each face, in double precision
+  vec3d min(inf_double, inf_double, inf_double);
+  vec3d max(-inf_double, -inf_double, -inf_double);
+  for (uint vid = 0; vid < mesh.num_verts; vid++) {
+    vec3d p = to_vec3d(to_vec(mesh.vert(vid)));
+    min = min.min(p);
+    max = max.max(p);
+  }
+  std::vector<vec3d> points(mesh.num_faces, vec3d(NAN, NAN, NAN));
+  std::vector<vec3d> normals_d(mesh.num_faces);
+  for (uint fid = 0; fid < mesh.num_faces; fid++) {
+    if (mesh.face_size(fid) > 0)
+      points.at(fid) = to_vec3d(to_vec(mesh.vert(mesh.face_vert(fid, 0))));
+    normals_d.at(fid) = to_vec3d(to_vec(mesh.normal(fid)));
+  }
+  PlaneHierarchy H;
+  H.build(points, normals_d, min.dist(max));
+  if (H.nodes.empty())
+    return;
+
+  // bounding ball of the kernel, updated after each cut, for a quick test.
+  // The kernel is convex, so it is inside a half-space iff all its vertices
+  // are, which is the exact test
+  std::vector<vec3d> kv;
+  vec3d c(0, 0, 0);
+  double r = inf_double;
+  auto update_ball = [&]() {
+    vec3d min(inf_double, inf_double, inf_double);
+    vec3d max(-inf_double, -inf_double, -inf_double);
+    kv.resize(kernel_verts.size());
+    for (uint vid = 0; vid < kernel_verts.size(); vid++) {
+      kv.at(vid) = to_vec3d(kernel_verts.at(vid));
+      min = min.min(kv.at(vid));
+      max = max.max(kv.at(vid));
+    }
+    c = (min + max) * 0.5;
+    r = min.dist(max) * 0.5;
+  };
+  update_ball();
+  auto skip = [&](const PlaneHierarchy::Node &node, const double d) {
+    if (d > r)
+      return true;
+    for (const vec3d &p : kv)
+      if (H.depth(node, p) <= TOLL)
+        return false;
+    return true;
+  };
+
+  // nodes are visited best first, starting from the one whose planes are
+  // expected to cut deepest, so that the kernel shrinks early and most nodes
+  // are skipped. Depths in the queue are those of the ball when the node was
+  // pushed, and are checked again when it is popped
+  using Entry = std::pair<double, int>;
+  std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> queue;
+  queue.push({H.depth(H.nodes.front(), c), 0});
+  uint done = 0; // faces clipped or skipped
+  const uint arity = uniform_arity(mesh);
+  while (!queue.empty()) {
+    if (budget && budget->expired()) {
+      for (; !queue.empty(); queue.pop()) {
+        const PlaneHierarchy::Node &node = H.nodes.at(queue.top().second);
+        num_unapplied += node.end - node.begin;
+      }
       return;
     }
+    int id = queue.top().second;
+    queue.pop();
+    // a copy, since splitting adds nodes
+    const PlaneHierarchy::Node node = H.nodes.at(id);
+    if (skip(node, H.depth(node, c))) { // no plane of the node cuts the kernel
+      done += node.end - node.begin;
+      continue;
+    }
+    if (H.split(id)) {
+      for (int child : {H.nodes.at(id).left, H.nodes.at(id).right}) {
+        const PlaneHierarchy::Node &n = H.nodes.at(child);
+        double d = H.depth(n, c);
+        if (skip(n, d))
+          done += n.end - n.begin;
+        else
+          queue.push({d, child});
+      }
+      continue;
+    }
+    for (uint i = node.begin; i < node.end; i++) {
+      uint fid = H.faces_ids.at(i);
+      const vec3d &n = normals_d.at(fid), &p = points.at(fid);
+      if (std::all_of(kv.begin(), kv.end(),
+                      [&](const vec3d &k) { return n.dot(k - p) < -TOLL; }))
+        continue; // the kernel is below the face
+      uint clips = num_clips;
+      if (!(arity == 3   ? clip_face<3>(mesh, fid)
+            : arity == 4 ? clip_face<4>(mesh, fid)
+                         : clip_face<0>(mesh, fid)))
+        return;
+      if (num_clips == clips)
+        continue;
+      if (simplify_interval > 0 && num_clips % simplify_interval == 0)
+        simplify();
+      update_ball();
+    }
+    done += node.end - node.begin;
+    if (budget && budget->progress)
+      budget->progress(done, H.faces_ids.size());
   }
 }
 
 //::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
 
+template <class T>
 CINO_INLINE
-void PolyhedronKernel::polyhedron_plane_intersection(
-    std::vector<vec3d> &verts, const std::vector<INTERSECTION_TYPE> &v_sign,
-    std::vector<std::vector<uint>> &faces, const ExtendedPlane &plane) {
-  std::vector<vec3d> above_v;
-  std::vector<INTERSECTION_TYPE> above_s;
-  std::vector<std::vector<uint>> above_f;
+void PolyhedronKernel<T>::compute_next(
+    const std::vector<vec> &verts,
+    const std::vector<std::vector<uint>> &faces,
+    const std::vector<vec> &normals, KernelMetrics *metrics) {
+  KERNEL_MEMORY_PHASE(PHASE_PLANES);
+  initialize(verts);
+  if (sequence_order.size() != faces.size()) { // first frame
+    sequence_order.resize(faces.size());
+    std::iota(sequence_order.begin(), sequence_order.end(), 0);
+  }
+  std::vector<bool> cut(faces.size(), false);
+  compute_mesh(VectorMeshView<T>(verts, &faces, &normals), &sequence_order,
+               metrics, nullptr, &cut);
+
+  // next order: supporting planes, then the other planes that cut this
+  // frame, then the rest
+  std::vector<bool> taken(faces.size(), false);
+  std::vector<uint> order;
+  order.reserve(faces.size());
+  for (int fid : kernel_face_planes)
+    if (fid >= 0 && !taken.at(fid)) {
+      taken.at(fid) = true;
+      order.push_back(fid);
+    }
+  for (uint fid : sequence_order)
+    if (cut.at(fid) && !taken.at(fid)) {
+      taken.at(fid) = true;
+      order.push_back(fid);
+    }
+  for (uint fid : sequence_order)
+    if (!taken.at(fid))
+      order.push_back(fid);
+  sequence_order.swap(order);
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+template <class T>
+CINO_INLINE
+bool PolyhedronKernel<T>::compute_float_first(
+    const std::vector<vec3d> &verts,
+    const std::vector<std::vector<uint>> &faces,
+    const std::vector<vec3d> &normals, const bool &shuffle,
+    const SEED_TYPE &seed, KernelMetrics *metrics,
+    const ComputeBudget *budget) {
+  std::vector<vec3f> verts_f(verts.size()), normals_f(normals.size());
+  for (uint vid = 0; vid < verts.size(); vid++)
+    verts_f.at(vid) = vec3f(verts.at(vid).x(), verts.at(vid).y(),
+                            verts.at(vid).z());
+  for (uint fid = 0; fid < normals.size(); fid++)
+    normals_f.at(fid) = vec3f(normals.at(fid).x(), normals.at(fid).y(),
+                              normals.at(fid).z());
+  PolyhedronKernel<float> K;
+  K.parallel_threshold = parallel_threshold;
+  K.hierarchy_threshold = hierarchy_threshold;
+  K.simplify_interval = simplify_interval;
+  K.simplify_toll = simplify_toll;
+  K.lazy_faces = lazy_faces;
+  K.output_half_spaces = output_half_spaces;
+  K.initialize(verts_f, PolyhedronKernel<float>::SEED_TYPE(seed));
+  K.compute(verts_f, faces, normals_f, shuffle, nullptr, budget);
+
+  // check the float kernel in double precision, with a tolerance relative to
+  // the mesh size
+  vec3d min(inf_double, inf_double, inf_double);
+  vec3d max(-inf_double, -inf_double, -inf_double);
+  for (const vec3d &p : verts) {
+    min = min.min(p);
+    max = max.max(p);
+  }
+  double toll = 64 * std::numeric_limits<float>::epsilon() * min.dist(max);
+  bool suspect = K.kernel_verts.empty();
+  std::unordered_map<uint64_t, uint> edges; // the kernel must be watertight
+  for (const std::vector<uint> &kf : K.kernel_faces)
+    for (uint i = 0; i < kf.size(); i++)
+      edges[(uint64_t(kf.at(i)) << 32) | kf.at((i + 1) % kf.size())]++;
+  for (const auto &e : edges)
+    if (e.second != 1 ||
+        edges.find((e.first << 32) | (e.first >> 32)) == edges.end())
+      suspect = true;
+  std::vector<vec3d> kv(K.kernel_verts.size());
+  for (uint vid = 0; vid < kv.size(); vid++)
+    kv.at(vid) = vec3d(K.kernel_verts.at(vid).x(), K.kernel_verts.at(vid).y(),
+                       K.kernel_verts.at(vid).z());
+  // the kernel is convex: the vertex farthest along a face normal is found
+  // by walking the kernel edges uphill, starting from the one of the
+  // previous face (faces with near normals are often consecutive)
+  std::vector<std::vector<uint>> kv_adj(kv.size());
+  for (const auto &e : edges)
+    kv_adj.at(e.first >> 32).push_back(e.first & 0xffffffff);
+  uint top = 0;
+  for (uint fid = 0; fid < faces.size() && !suspect && !kv.empty(); fid++) {
+    if (faces.at(fid).empty() || normals.at(fid).is_deg())
+      continue;
+    const vec3d &n = normals.at(fid);
+    for (bool moved = true; moved;) {
+      moved = false;
+      for (uint vid : kv_adj.at(top))
+        if (n.dot(kv.at(vid)) > n.dot(kv.at(top))) {
+          top = vid;
+          moved = true;
+        }
+    }
+    if (n.dot(kv.at(top) - verts.at(faces.at(fid).front())) > toll)
+      suspect = true; // vertex outside a face half-space
+  }
+  // each kernel face must lie on the plane it comes from: the input face in
+  // kernel_face_planes or, for -1, a face of the seed box (rebuilt in double)
+  PolyhedronKernel<double> box;
+  box.initialize(verts, PolyhedronKernel<double>::SEED_TYPE(seed));
+  std::vector<std::pair<vec3d, vec3d>> box_planes; // normal and point
+  for (const std::vector<uint> &bf : box.kernel_faces) {
+    const vec3d &p = box.kernel_verts.at(bf.at(0));
+    vec3d n = (box.kernel_verts.at(bf.at(1)) - p)
+                  .cross(box.kernel_verts.at(bf.at(2)) - p);
+    n.normalize();
+    box_planes.push_back(std::make_pair(n, p));
+  }
+  for (uint kfid = 0;
+       kfid < K.kernel_faces.size() &&
+       kfid < K.kernel_face_planes.size() && !suspect;
+       kfid++) {
+    const std::vector<uint> &kf = K.kernel_faces.at(kfid);
+    auto on_plane = [&](const vec3d &n, const vec3d &p) {
+      for (uint vid : kf)
+        if (fabs(n.dot(kv.at(vid) - p)) > toll)
+          return false;
+      return true;
+    };
+    int fid = K.kernel_face_planes.at(kfid);
+    bool supported = false;
+    if (fid < 0)
+      for (uint i = 0; i < box_planes.size() && !supported; i++)
+        supported = on_plane(box_planes.at(i).first, box_planes.at(i).second);
+    else if (!normals.at(fid).is_deg()) {
+      vec3d n = normals.at(fid);
+      n.normalize();
+      supported = on_plane(n, verts.at(faces.at(fid).front()));
+    }
+    suspect = !supported; // face not lying on its plane
+  }
+  if (K.kernel_face_planes.size() != K.kernel_faces.size())
+    suspect = true;
+  // a kernel stopped by the budget misses planes by design: it is kept
+  // without the checks, as the partial kernel of compute would be
+  if (K.num_unapplied > 0 && !K.kernel_verts.empty())
+    suspect = false;
+
+  if (suspect) { // recompute in precision T
+    std::vector<vec> verts_T(verts.size()), normals_T(normals.size());
+    for (uint vid = 0; vid < verts.size(); vid++)
+      verts_T.at(vid) =
+          vec(verts.at(vid).x(), verts.at(vid).y(), verts.at(vid).z());
+    for (uint fid = 0; fid < normals.size(); fid++)
+      normals_T.at(fid) =
+          vec(normals.at(fid).x(), normals.at(fid).y(), normals.at(fid).z());
+    initialize(verts_T, seed);
+    compute(verts_T, faces, normals_T, shuffle, metrics, budget);
+    return false;
+  }
+  kernel_verts.resize(kv.size());
+  for (uint vid = 0; vid < kv.size(); vid++)
+    kernel_verts.at(vid) = vec(kv.at(vid).x(), kv.at(vid).y(), kv.at(vid).z());
+  kernel_faces = K.kernel_faces;
+  kernel_face_planes = K.kernel_face_planes;
+  kernel_incidence.clear();
+  incidence_planes.clear();
+  kernel_half_spaces = K.kernel_half_spaces; // already in double
+  cut_planes.clear();
+  num_clips = K.num_clips;
+  num_unapplied = K.num_unapplied;
+  num_simplified_verts = K.num_simplified_verts;
+  num_simplified_faces = K.num_simplified_faces;
+  if (metrics)
+    *metrics = compute_metrics();
+  return true;
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
 
+template <class T>
+CINO_INLINE
+double PolyhedronKernel<T>::compute_approximate(
+    const std::vector<vec> &verts,
+    const std::vector<std::vector<uint>> &faces,
+    const std::vector<vec> &normals, const double &toll,
+    KernelMetrics *metrics, const ComputeBudget *budget) {
+  KERNEL_MEMORY_PHASE(PHASE_PLANES);
+  if (kernel_verts.empty() || kernel_faces.empty()) {
+    std::cout << "ERROR: initialize kernel before computing." << std::endl;
+    return inf_double;
+  }
+  // the initial kernel B contains the exact one: every bound below is taken
+  // over B, where a linear function v.x ranges in v.o +- |v|.h
+  vec o(0, 0, 0), h(0, 0, 0);
+  {
+    vec min(INF, INF, INF);
+    vec max(-INF, -INF, -INF);
+    for (const vec &p : kernel_verts) {
+      min = min.min(p);
+      max = max.max(p);
+    }
+    o = (min + max) * 0.5;
+    h = (max - min) * 0.5;
+  }
+  T diag = 2 * h.norm();
+  auto max_B = [&](const vec &v) -> T {
+    return v.dot(o) + fabs(v.x()) * h.x() + fabs(v.y()) * h.y() +
+           fabs(v.z()) * h.z();
+  };
+
+  // cluster the inward face planes n.x >= d on a grid of cell size toll over
+  // the normal components and toll * diag over the offset wrt o
+  std::map<std::array<long long, 4>, uint> cluster_map;
+  std::vector<std::vector<uint>> clusters;
   for (uint fid = 0; fid < faces.size(); fid++) {
-    std::vector<uint> f = faces.at(fid);
-    std::vector<INTERSECTION_TYPE> fs(f.size());
-    for (uint vid = 0; vid < f.size(); vid++)
-      fs.at(vid) = v_sign.at(f.at(vid));
-    switch (classify(fs)) {
-    case BELOW: // face strictly below the plane
-      break;
-    case ABOVE: { // face weakly above the plane
-      for (uint &vid : f) {
-        auto it = find_v(above_v.begin(), above_v.end(), verts.at(vid));
-        if (it == above_v.end()) {
-          above_v.push_back(verts.at(vid));
-          above_s.push_back(v_sign.at(vid));
-          vid = above_v.size() - 1;
-        } else
-          vid = it - above_v.cbegin();
+    const std::vector<uint> &f = faces.at(fid);
+    if (f.size() == 0 || verts.at(f.front()).is_nan() ||
+        verts.at(f.front()).is_inf() || normals.at(fid).is_deg()) {
+      std::cout << "WARNING: skipping degenerate face." << std::endl;
+      continue;
+    }
+    vec n = -normals.at(fid);
+    T e = n.dot(verts.at(f.front()) - o);
+    std::array<long long, 4> key = {
+        std::llround(n.x() / toll), std::llround(n.y() / toll),
+        std::llround(n.z() / toll), std::llround(e / (toll * diag))};
+    auto it = cluster_map.find(key);
+    if (it == cluster_map.end()) {
+      cluster_map[key] = clusters.size();
+      clusters.push_back({fid});
+    } else
+      clusters.at(it->second).push_back(fid);
+  }
+
+  // the planes to clip with, as the faces of a mesh: a cluster of one face is
+  // the face itself (exact plane, as in compute), the others are a single
+  // vertex on their representative plane. source maps the faces of this mesh
+  // back to the input faces (-1 for representative planes)
+  std::vector<vec> cluster_verts(verts);
+  std::vector<std::vector<uint>> cluster_faces;
+  std::vector<vec> cluster_normals;
+  std::vector<int> source;
+  T delta = 0; // max offset between a cluster and its representative
+  for (const std::vector<uint> &cluster : clusters) {
+    if (cluster.size() == 1) {
+      uint fid = cluster.front();
+      cluster_faces.push_back(faces.at(fid));
+      cluster_normals.push_back(normals.at(fid));
+      source.push_back(fid);
+      continue;
+    }
+    // representative plane n.x >= d, conservative over B:
+    // n.x >= d implies n_i.x >= d_i for every member i, since
+    // d = max_i (d_i + max_B (n - n_i).x)
+    vec n(0, 0, 0);
+    for (uint fid : cluster)
+      n -= normals.at(fid);
+    if (n.normalize() < TOLL)
+      n = -normals.at(cluster.front());
+    T d = -INF;
+    for (uint fid : cluster) {
+      vec ni = -normals.at(fid);
+      T di = ni.dot(verts.at(faces.at(fid).front()));
+      d = std::max(d, di + max_B(n - ni));
+    }
+    // conversely, shifting any member plane by delta_c inside B yields a
+    // half-space contained in the representative one
+    T delta_c = INF;
+    for (uint fid : cluster) {
+      vec ni = -normals.at(fid);
+      T di = ni.dot(verts.at(faces.at(fid).front()));
+      delta_c = std::min(delta_c, d - di + max_B(ni - n));
+    }
+    delta = std::max(delta, delta_c);
+    cluster_faces.push_back({uint(cluster_verts.size())});
+    cluster_verts.push_back(o + n * (d - n.dot(o)));
+    cluster_normals.push_back(-n); // the kernel is below the face
+    source.push_back(-1);
+  }
+  compute_mesh(
+      VectorMeshView<T>(cluster_verts, &cluster_faces, &cluster_normals),
+      nullptr, metrics, budget);
+  for (int &fid : kernel_face_planes)
+    if (fid >= 0)
+      fid = source.at(fid);
+  for (KernelHalfSpace &h : kernel_half_spaces)
+    if (h.face_id >= 0)
+      h.face_id = source.at(h.face_id);
+  std::stable_sort(kernel_half_spaces.begin(), kernel_half_spaces.end(),
+                   [](const KernelHalfSpace &a, const KernelHalfSpace &b) {
+                     return a.face_id < b.face_id;
+                   });
+  if (num_unapplied > 0) // stopped early, not inside the exact kernel
+    return inf_double;
+
+  // the approximate kernel K' is contained in the exact kernel K and contains
+  // K shifted inwards by delta. If the ball (c, r) is inscribed in K', the
+  // homothety of centre c and ratio 1 - delta/r maps K into K', hence
+  // d_H(K, K') <= delta * R / r, where R bounds the distance from c to B
+  if (delta == 0)
+    return 0;
+  vec c;
+  T r;
+  if (!chebyshev_center(c, r) || r <= 0)
+    return inf_double;
+  T R = 0;
+  for (uint i = 0; i < 8; i++) {
+    vec corner(i & 1 ? o.x() + h.x() : o.x() - h.x(),
+                 i & 2 ? o.y() + h.y() : o.y() - h.y(),
+                 i & 4 ? o.z() + h.z() : o.z() - h.z());
+    R = std::max(R, c.dist(corner));
+  }
+  return delta * R / r;
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+template <class T>
+CINO_INLINE
+void PolyhedronKernel<T>::simplify() {
+  if (!kernel_incidence.empty())
+    return; // no faces in incidence mode
+  const uint NONE = std::numeric_limits<uint>::max();
+  const uint nv = kernel_verts.size(), nf = kernel_faces.size();
+  const double toll = simplify_toll;
+
+  // 1) weld: vertices are swept by x, and each one is welded to the nearest
+  // previous vertex within distance toll that was not welded itself, so that
+  // no vertex moves farther than toll
+  std::vector<uint> order(nv), rep(nv);
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [&](uint a, uint b) {
+    return kernel_verts.at(a).x() < kernel_verts.at(b).x();
+  });
+  for (uint i = 0; i < nv; i++) {
+    const uint vid = order.at(i);
+    const vec &v = kernel_verts.at(vid);
+    rep.at(vid) = vid;
+    double best = toll;
+    for (uint j = i; j-- > 0;) {
+      const uint r = order.at(j);
+      const vec &w = kernel_verts.at(r);
+      if (v.x() - w.x() >= toll)
+        break;
+      double d = v.dist(w);
+      if (rep.at(r) == r && d < best) {
+        rep.at(vid) = r;
+        best = d;
       }
-      above_f.push_back(f);
-      break;
     }
-    case INTERSECT: { // face properly intersects the plane
-      std::vector<vec3d> fv(f.size());
+  }
+
+  // 2) remap the faces, dropping repeated vertices and the faces left with
+  // less than three vertices or thinner than toll. A thin face is collapsed
+  // onto the segment between its two farthest vertices: each face across one
+  // of its edges gets the vertices of the opposite side inserted in that
+  // edge, so that none is left in the middle of an edge. Thin faces whose
+  // sides are not monotone along the segment are kept
+  auto key = [](uint a, uint b) { return uint64_t(a) << 32 | b; };
+  std::unordered_map<uint64_t, std::vector<uint>> splits; // edge -> inserted
+  auto collapse = [&](const std::vector<uint> &f) {
+    auto pos = [&](uint i) { return to_vec3d(kernel_verts.at(f.at(i))); };
+    const uint k = f.size();
+    uint ip = 0, iq = 0;
+    for (uint i = 1; i < k; i++)
+      if (pos(i).dist(pos(0)) > pos(ip).dist(pos(0)))
+        ip = i;
+    for (uint i = 0; i < k; i++)
+      if (pos(i).dist(pos(ip)) > pos(iq).dist(pos(ip)))
+        iq = i;
+    const vec3d p = pos(ip), d = pos(iq) - p;
+    std::vector<double> t(k);
+    for (uint i = 0; i < k; i++)
+      t.at(i) = d.dot(pos(i) - p);
+    std::vector<uint> side[2]; // from p to q and from q to p
+    for (uint i = ip; side[0].push_back(i), i != iq; i = (i + 1) % k)
+      ;
+    for (uint i = iq; side[1].push_back(i), i != ip; i = (i + 1) % k)
+      ;
+    for (uint s = 0; s < 2; s++)
+      for (uint i = 1; i < side[s].size(); i++) {
+        double dt = t.at(side[s].at(i)) - t.at(side[s].at(i - 1));
+        if (s == 0 ? dt <= 0 : dt >= 0)
+          return false;
+      }
+    for (uint s = 0; s < 2; s++)
+      for (uint i = 1; i < side[s].size(); i++) {
+        // the face across a -> b runs b -> a, as the other side does
+        uint a = side[s].at(i - 1), b = side[s].at(i);
+        double lo = std::min(t.at(a), t.at(b)), hi = std::max(t.at(a), t.at(b));
+        std::vector<uint> &ins = splits[key(f.at(b), f.at(a))];
+        for (uint j : side[1 - s])
+          if (t.at(j) > lo && t.at(j) < hi)
+            ins.push_back(f.at(j));
+      }
+    return true;
+  };
+  std::vector<std::vector<uint>> faces;
+  std::vector<int> planes;
+  std::vector<vec3d> normals;
+  for (uint fid = 0; fid < nf; fid++) {
+    std::vector<uint> f;
+    for (uint vid : kernel_faces.at(fid))
+      if (f.empty() || f.back() != rep.at(vid))
+        f.push_back(rep.at(vid));
+    while (f.size() > 1 && f.front() == f.back())
+      f.pop_back();
+    if (f.size() < 3)
+      continue;
+    vec3d n(0, 0, 0); // twice the area, along the normal (Newell)
+    double max_edge = 0;
+    for (uint i = 0; i < f.size(); i++) {
+      vec3d a = to_vec3d(kernel_verts.at(f.at(i)));
+      vec3d b = to_vec3d(kernel_verts.at(f.at((i + 1) % f.size())));
+      n += a.cross(b);
+      max_edge = std::max(max_edge, a.dist(b));
+    }
+    double area2 = n.norm();
+    if (area2 < toll * max_edge && collapse(f)) // height below toll
+      continue;
+    faces.push_back(f);
+    planes.push_back(kernel_face_planes.at(fid));
+    normals.push_back(area2 > 0 ? n / area2 : n);
+  }
+  for (std::vector<uint> &f : faces) {
+    std::vector<uint> g;
+    for (uint i = 0; i < f.size(); i++) {
+      g.push_back(f.at(i));
+      auto it = splits.find(key(f.at(i), f.at((i + 1) % f.size())));
+      if (it != splits.end())
+        for (uint vid : it->second)
+          if (std::find(f.begin(), f.end(), vid) == f.end())
+            g.push_back(vid);
+    }
+    f.swap(g);
+  }
+
+  // 3) merge coplanar faces: starting from a root face, the adjacent faces
+  // whose vertices all lie within toll of the root plane are collected, and
+  // replaced by the boundary of their union when it is a single loop
+  std::unordered_map<uint64_t, uint> edge_face; // directed edge -> face
+  for (uint fid = 0; fid < faces.size(); fid++) {
+    const std::vector<uint> &f = faces.at(fid);
+    for (uint i = 0; i < f.size(); i++)
+      edge_face[key(f.at(i), f.at((i + 1) % f.size()))] = fid;
+  }
+  std::vector<uint> group(faces.size(), NONE);
+  std::vector<std::vector<uint>> merged_faces;
+  std::vector<int> merged_planes;
+  for (uint root = 0; root < faces.size(); root++) {
+    if (group.at(root) != NONE)
+      continue;
+    group.at(root) = root;
+    const vec3d &n = normals.at(root);
+    const vec3d p = to_vec3d(kernel_verts.at(faces.at(root).front()));
+    std::vector<uint> members = {root};
+    for (uint m = 0; m < members.size(); m++) {
+      const std::vector<uint> &f = faces.at(members.at(m));
+      for (uint i = 0; i < f.size(); i++) {
+        auto it = edge_face.find(key(f.at((i + 1) % f.size()), f.at(i)));
+        if (it == edge_face.end() || group.at(it->second) != NONE ||
+            n.dot(normals.at(it->second)) <= 0)
+          continue;
+        const std::vector<uint> &g = faces.at(it->second);
+        if (std::all_of(g.begin(), g.end(), [&](uint vid) {
+              return fabs(n.dot(to_vec3d(kernel_verts.at(vid)) - p)) < toll;
+            })) {
+          group.at(it->second) = root;
+          members.push_back(it->second);
+        }
+      }
+    }
+    std::unordered_map<uint, uint> next; // boundary edges of the group
+    bool loop_ok = members.size() > 1;
+    for (uint fid : members) {
+      const std::vector<uint> &f = faces.at(fid);
+      for (uint i = 0; i < f.size() && loop_ok; i++) {
+        uint a = f.at(i), b = f.at((i + 1) % f.size());
+        auto it = edge_face.find(key(b, a));
+        if (it == edge_face.end() || group.at(it->second) != root)
+          loop_ok = next.emplace(a, b).second;
+      }
+    }
+    std::vector<uint> loop;
+    if (loop_ok && !next.empty()) {
+      uint start = next.begin()->first, vid = start;
+      do {
+        loop.push_back(vid);
+        auto it = next.find(vid);
+        vid = it == next.end() ? NONE : it->second;
+      } while (vid != start && vid != NONE && loop.size() <= next.size());
+      loop_ok = vid == start && loop.size() == next.size() && loop.size() > 2;
+    }
+    if (loop_ok) {
+      merged_faces.push_back(loop);
+      merged_planes.push_back(planes.at(root));
+    } else
+      for (uint fid : members) {
+        merged_faces.push_back(faces.at(fid));
+        merged_planes.push_back(planes.at(fid));
+      }
+  }
+
+  // 4) remove the vertices on two faces only that lie within toll of the
+  // line through their neighbours in both (the kernel may be split at near
+  // coincident vertices, which are then corners on two faces each), and
+  // compact the vertices
+  std::vector<uint> valence(nv, 0);
+  for (const std::vector<uint> &f : merged_faces)
+    for (uint vid : f)
+      valence.at(vid)++;
+  std::vector<bool> removable(nv);
+  for (uint vid = 0; vid < nv; vid++)
+    removable.at(vid) = valence.at(vid) <= 2;
+  for (const std::vector<uint> &f : merged_faces)
+    for (uint i = 0; i < f.size(); i++) {
+      if (!removable.at(f.at(i)))
+        continue;
+      vec3d a = to_vec3d(kernel_verts.at(f.at((i + f.size() - 1) % f.size())));
+      vec3d b = to_vec3d(kernel_verts.at(f.at((i + 1) % f.size())));
+      vec3d v = to_vec3d(kernel_verts.at(f.at(i)));
+      double len = a.dist(b);
+      if (len == 0 || (b - a).cross(v - a).norm() >= toll * len)
+        removable.at(f.at(i)) = false;
+    }
+  // a vertex is removed from both its faces or from none (otherwise it would
+  // be left on an edge of the other one): faces that would drop below three
+  // vertices keep all theirs. Keeping vertices only adds to the other faces,
+  // so one pass is enough
+  for (const std::vector<uint> &f : merged_faces)
+    if (std::count_if(f.begin(), f.end(),
+                      [&](uint vid) { return !removable.at(vid); }) < 3)
+      for (uint vid : f)
+        removable.at(vid) = false;
+  std::vector<uint> new_vid(nv, NONE);
+  std::vector<vec> verts;
+  for (std::vector<uint> &f : merged_faces) {
+    f.erase(std::remove_if(f.begin(), f.end(),
+                           [&](uint vid) { return removable.at(vid); }),
+            f.end());
+    for (uint &vid : f) {
+      if (new_vid.at(vid) == NONE) {
+        new_vid.at(vid) = verts.size();
+        verts.push_back(kernel_verts.at(vid));
+      }
+      vid = new_vid.at(vid);
+    }
+  }
+  clip_new_vid.resize(nv);
+  for (uint vid = 0; vid < nv; vid++)
+    clip_new_vid.at(vid) = new_vid.at(rep.at(vid));
+  num_simplified_verts += nv - verts.size();
+  num_simplified_faces += nf - merged_faces.size();
+  kernel_verts.swap(verts);
+  kernel_faces.swap(merged_faces);
+  kernel_face_planes.swap(merged_planes);
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+template <class T>
+CINO_INLINE
+void PolyhedronKernel<T>::to_incidence() {
+  kernel_incidence.assign(kernel_verts.size(), {});
+  incidence_planes = kernel_face_planes; // plane i supports face i
+  for (uint fid = 0; fid < kernel_faces.size(); fid++)
+    for (uint vid : kernel_faces.at(fid))
+      kernel_incidence.at(vid).push_back(fid);
+  kernel_faces.clear();
+  kernel_face_planes.clear();
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+template <class T>
+CINO_INLINE
+void PolyhedronKernel<T>::assemble_faces() {
+  KERNEL_MEMORY_PHASE(PHASE_CAP);
+  const uint NONE = std::numeric_limits<uint>::max();
+
+  // where more than three planes meet, rounding can split the vertex into
+  // near coincident ones, which the faces through it would chain in
+  // different orders. Vertices sharing three planes are the same point, and
+  // are merged (with the union of their planes) before assembling
+  std::vector<uint> rep(kernel_incidence.size());
+  std::iota(rep.begin(), rep.end(), 0);
+  auto find = [&](uint vid) {
+    while (rep.at(vid) != vid)
+      vid = rep.at(vid) = rep.at(rep.at(vid));
+    return vid;
+  };
+  std::map<std::array<uint, 3>, uint> corners; // plane triple -> vertex
+  bool split = false;
+  for (uint vid = 0; vid < kernel_incidence.size(); vid++) {
+    const std::vector<uint> &inc = kernel_incidence.at(vid);
+    for (uint i = 0; i < inc.size(); i++)
+      for (uint j = i + 1; j < inc.size(); j++)
+        for (uint k = j + 1; k < inc.size(); k++) {
+          auto it = corners.emplace(
+              std::array<uint, 3>{inc.at(i), inc.at(j), inc.at(k)}, vid);
+          if (!it.second && find(vid) != find(it.first->second)) {
+            rep.at(find(vid)) = find(it.first->second);
+            split = true;
+          }
+        }
+  }
+  if (split) {
+    std::vector<uint> new_vid(kernel_incidence.size(), NONE);
+    std::vector<vec> verts;
+    std::vector<std::vector<uint>> incidence;
+    for (uint vid = 0; vid < kernel_incidence.size(); vid++)
+      if (find(vid) == vid) {
+        new_vid.at(vid) = verts.size();
+        verts.push_back(kernel_verts.at(vid));
+        incidence.push_back(kernel_incidence.at(vid));
+      }
+    for (uint vid = 0; vid < kernel_incidence.size(); vid++)
+      if (find(vid) != vid) {
+        std::vector<uint> &inc = incidence.at(new_vid.at(find(vid)));
+        std::vector<uint> merged;
+        std::set_union(inc.begin(), inc.end(), kernel_incidence.at(vid).begin(),
+                       kernel_incidence.at(vid).end(),
+                       std::back_inserter(merged));
+        inc.swap(merged);
+      }
+    kernel_verts.swap(verts);
+    kernel_incidence.swap(incidence);
+  }
+
+  std::vector<std::vector<uint>> plane_verts(incidence_planes.size());
+  vec3d c(0, 0, 0); // inside the kernel, to orient the faces
+  for (uint vid = 0; vid < kernel_incidence.size(); vid++) {
+    for (uint p : kernel_incidence.at(vid))
+      plane_verts.at(p).push_back(vid);
+    c += to_vec3d(kernel_verts.at(vid));
+  }
+  c /= std::max<double>(1, kernel_incidence.size());
+  kernel_faces.clear();
+  kernel_face_planes.clear();
+  std::unordered_map<uint, std::vector<uint>> lines, adj;
+  for (uint p = 0; p < plane_verts.size(); p++) {
+    const std::vector<uint> &fv = plane_verts.at(p);
+    if (fv.size() < 3)
+      continue;
+    // the edges of face p join its vertices on a second common plane
+    // (consecutive ones, if more than two are aligned)
+    lines.clear();
+    adj.clear();
+    for (uint vid : fv)
+      for (uint q : kernel_incidence.at(vid))
+        if (q != p)
+          lines[q].push_back(vid);
+    for (auto &line : lines) {
+      std::vector<uint> &l = line.second;
+      if (l.size() > 2)
+        sort_along_line(l);
+      for (uint i = 0; i + 1 < l.size(); i++) {
+        adj[l.at(i)].push_back(l.at(i + 1));
+        adj[l.at(i + 1)].push_back(l.at(i));
+      }
+    }
+    std::vector<uint> f;
+    bool chained = adj.size() == fv.size() &&
+                   std::all_of(adj.begin(), adj.end(),
+                               [](const auto &a) { return a.second.size() == 2; });
+    if (chained) {
+      uint prev = NONE, vid = fv.front();
+      do {
+        f.push_back(vid);
+        const std::vector<uint> &n = adj.at(vid);
+        uint next = n.at(0) != prev ? n.at(0) : n.at(1);
+        prev = vid;
+        vid = next;
+      } while (vid != fv.front() && f.size() <= fv.size());
+      chained = vid == fv.front() && f.size() == fv.size();
+    }
+    if (!chained) { // degenerate incidences, sort by angle
+      std::vector<vec> points(fv.size());
+      for (uint i = 0; i < fv.size(); i++)
+        points.at(i) = kernel_verts.at(fv.at(i));
+      f.clear();
+      for (uint i : sort_points(points, ExtendedPlane<T>(points)))
+        f.push_back(fv.at(i));
+      if (f.size() < 3)
+        continue;
+    }
+    vec3d n(0, 0, 0), fc(0, 0, 0); // faces point outwards
+    for (uint i = 0; i < f.size(); i++) {
+      vec3d a = to_vec3d(kernel_verts.at(f.at(i)));
+      n += a.cross(to_vec3d(kernel_verts.at(f.at((i + 1) % f.size()))));
+      fc += a;
+    }
+    if (n.dot(fc / double(f.size()) - c) < 0)
+      std::reverse(f.begin(), f.end());
+    kernel_faces.push_back(f);
+    kernel_face_planes.push_back(incidence_planes.at(p));
+  }
+  kernel_incidence.clear();
+  incidence_planes.clear();
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+template <class T>
+CINO_INLINE
+KernelMetrics PolyhedronKernel<T>::compute_metrics() const {
+  // accumulated in double precision whatever the scalar type
+  KernelMetrics m;
+  if (kernel_verts.empty())
+    return m;
+  m.bbox_min = vec3d(inf_double, inf_double, inf_double);
+  m.bbox_max = vec3d(-inf_double, -inf_double, -inf_double);
+  for (const vec &p : kernel_verts) {
+    m.bbox_min = m.bbox_min.min(to_vec3d(p));
+    m.bbox_max = m.bbox_max.max(to_vec3d(p));
+  }
+
+  // divergence theorem over the fan triangulation of each face: sum the
+  // signed volumes of the tetrahedra (o, v0, vi, vi+1), with o chosen inside
+  // the AABB to limit cancellation
+  vec3d o = (m.bbox_min + m.bbox_max) * 0.5;
+  double vol = 0;
+  vec3d c(0, 0, 0);
+  for (const std::vector<uint> &f : kernel_faces) {
+    vec3d v0 = to_vec3d(kernel_verts.at(f.front())) - o;
+    for (uint i = 1; i + 1 < f.size(); i++) {
+      vec3d v1 = to_vec3d(kernel_verts.at(f.at(i))) - o;
+      vec3d v2 = to_vec3d(kernel_verts.at(f.at(i + 1))) - o;
+      double t = v0.dot(v1.cross(v2)) / 6.0;
+      vol += t;
+      c += (v0 + v1 + v2) * (t / 4.0);
+    }
+  }
+  m.volume = vol;
+  m.centroid = (fabs(vol) > 0) ? o + c / vol : o;
+  return m;
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+template <class T>
+CINO_INLINE
+void PolyhedronKernel<T>::collect_half_spaces() {
+  kernel_half_spaces.clear();
+  kernel_half_spaces.reserve(kernel_faces.size());
+  for (uint fid = 0; fid < kernel_faces.size(); fid++) {
+    auto it = cut_planes.find(kernel_face_planes.at(fid));
+    if (it != cut_planes.end()) {
+      kernel_half_spaces.push_back(it->second);
+      continue;
+    }
+    KernelHalfSpace h; // Newell normal and mean offset of the face
+    const std::vector<uint> &f = kernel_faces.at(fid);
+    vec3d c(0, 0, 0);
+    for (uint i = 0; i < f.size(); i++) {
+      vec3d a = to_vec3d(kernel_verts.at(f.at(i)));
+      vec3d b = to_vec3d(kernel_verts.at(f.at((i + 1) % f.size())));
+      h.normal += vec3d((a[1] - b[1]) * (a[2] + b[2]),
+                        (a[2] - b[2]) * (a[0] + b[0]),
+                        (a[0] - b[0]) * (a[1] + b[1]));
+      c += a;
+    }
+    h.normal.normalize();
+    h.offset = h.normal.dot(c / double(f.size()));
+    kernel_half_spaces.push_back(h);
+  }
+  std::stable_sort(kernel_half_spaces.begin(), kernel_half_spaces.end(),
+                   [](const KernelHalfSpace &a, const KernelHalfSpace &b) {
+                     return a.face_id < b.face_id;
+                   });
+  // a plane supports at most one face, unless the face was split
+  kernel_half_spaces.erase(
+      std::unique(kernel_half_spaces.begin(), kernel_half_spaces.end(),
+                  [](const KernelHalfSpace &a, const KernelHalfSpace &b) {
+                    return a.face_id >= 0 && a.face_id == b.face_id;
+                  }),
+      kernel_half_spaces.end());
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+template <class T>
+CINO_INLINE
+bool PolyhedronKernel<T>::chebyshev_center(vec &center, T &radius) const {
+  center = vec(0, 0, 0);
+  radius = 0;
+  if (kernel_verts.empty() || kernel_faces.empty())
+    return false;
+
+  // work in a frame centred in the kernel AABB and scaled to [-1,1]^3
+  vec min(INF, INF, INF);
+  vec max(-INF, -INF, -INF);
+  for (const vec &p : kernel_verts) {
+    min = min.min(p);
+    max = max.max(p);
+  }
+  vec o = (min + max) * 0.5;
+  T scale = 0.5 * (max - min).norm();
+  if (scale < TOLL) {
+    center = o;
+    return true;
+  }
+
+  // each kernel face is supported by a non-redundant plane n.x >= d, with n
+  // pointing towards the interior: the ball (x,r) is inside if n.x - r >= d
+  std::vector<LPConstraint> H;
+  H.reserve(kernel_faces.size() + 1);
+  for (const std::vector<uint> &f : kernel_faces) {
+    vec n(0, 0, 0), c(0, 0, 0); // Newell's normal (outward) and centroid
+    for (uint i = 0; i < f.size(); i++) {
+      vec p0 = (kernel_verts.at(f.at(i)) - o) / scale;
+      vec p1 = (kernel_verts.at(f.at((i + 1) % f.size())) - o) / scale;
+      n += vec((p0.y() - p1.y()) * (p0.z() + p1.z()),
+                 (p0.z() - p1.z()) * (p0.x() + p1.x()),
+                 (p0.x() - p1.x()) * (p0.y() + p1.y()));
+      c += p0;
+    }
+    if (n.normalize() < TOLL)
+      continue; // degenerate face
+    c /= static_cast<T>(f.size());
+    LPConstraint h;
+    h.a[0] = n.x();
+    h.a[1] = n.y();
+    h.a[2] = n.z();
+    h.a[3] = 1;
+    h.b = n.dot(c);
+    H.push_back(h);
+  }
+  LPConstraint r_positive;
+  r_positive.a[3] = -1;
+  H.push_back(r_positive);
+
+  double obj[LP_MAX_DIM] = {0, 0, 0, 1};
+  double x[LP_MAX_DIM];
+  if (!seidel_lp(H, obj, 4, 2.0, x))
+    return false;
+  center = o + vec(x[0], x[1], x[2]) * scale;
+  radius = x[3] * scale;
+  return true;
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+template <class T>
+CINO_INLINE
+bool PolyhedronKernel<T>::kernel_dop(
+    const std::vector<vec> &verts, const std::vector<std::vector<uint>> &faces,
+    const std::vector<vec> &normals, const std::vector<vec> &dirs,
+    std::vector<T> &lo, std::vector<T> &hi) {
+  lo.assign(dirs.size(), 0);
+  hi.assign(dirs.size(), 0);
+  if (verts.empty())
+    return false;
+
+  // work in a frame centred in the mesh AABB and scaled to [-1,1]^3, which
+  // contains the kernel
+  vec min(INF, INF, INF);
+  vec max(-INF, -INF, -INF);
+  for (const vec &p : verts) {
+    min = min.min(p);
+    max = max.max(p);
+  }
+  vec o = (min + max) * 0.5;
+  T scale = std::max<T>(0.5 * (max - min).norm(), TOLL);
+
+  // each face gives n.x <= n.p, with n its outward normal, relaxed by the
+  // kernel tolerance as in compute
+  std::vector<LPConstraint> H;
+  H.reserve(faces.size());
+  for (uint fid = 0; fid < faces.size(); fid++) {
+    const std::vector<uint> &f = faces.at(fid);
+    if (f.size() < 3 || normals.at(fid).is_deg())
+      continue;
+    vec n = normals.at(fid);
+    n.normalize();
+    LPConstraint h;
+    h.a[0] = n.x();
+    h.a[1] = n.y();
+    h.a[2] = n.z();
+    h.b = (n.dot(verts.at(f.front()) - o) + TOLL) / scale;
+    H.push_back(h);
+  }
+
+  // bound of the LP variables, around the [-1,1]^3 frame of the mesh
+  const double LP_BOX = 2.0;
+
+  // shuffled once (as seidel_lp does at each call) for all the LPs, which
+  // share the constraints
+  std::mt19937 g(0);
+  std::shuffle(H.begin(), H.end(), g);
+  for (uint i = 0; i < dirs.size(); i++) {
+    const vec &d = dirs.at(i);
+    for (const T sign : {T(1), T(-1)}) {
+      double obj[LP_MAX_DIM] = {sign * d.x(), sign * d.y(), sign * d.z(), 0};
+      double x[LP_MAX_DIM];
+      if (!seidel_lp_rec(H, obj, 3, LP_BOX, 1e-12, x))
+        return false;
+      // the optimum is within the box of the LP, or it failed numerically
+      for (uint j = 0; j < 3; j++)
+        if (!(fabs(x[j]) <= LP_BOX * (1 + 1e-9)))
+          return false;
+      T ext = d.dot(o + vec(x[0], x[1], x[2]) * scale);
+      (sign > 0 ? hi : lo).at(i) = ext;
+    }
+  }
+  return true;
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+template <class T>
+CINO_INLINE
+bool PolyhedronKernel<T>::kernel_aabb(
+    const std::vector<vec> &verts, const std::vector<std::vector<uint>> &faces,
+    const std::vector<vec> &normals, vec &min, vec &max) {
+  std::vector<vec> axes = {vec(1, 0, 0), vec(0, 1, 0), vec(0, 0, 1)};
+  std::vector<T> lo, hi;
+  bool ok = kernel_dop(verts, faces, normals, axes, lo, hi);
+  min = vec(lo.at(0), lo.at(1), lo.at(2));
+  max = vec(hi.at(0), hi.at(1), hi.at(2));
+  return ok;
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+template <class T>
+CINO_INLINE
+bool PolyhedronKernel<T>::cross_section(
+    const std::vector<vec> &verts, const std::vector<std::vector<uint>> &faces,
+    const std::vector<vec> &normals, const ExtendedPlane<T> &plane,
+    std::vector<vec> &polygon) {
+  typedef mat<2, 1, T> vec2;
+  polygon.clear();
+  if (verts.empty() || plane.n.is_deg() || plane.n.norm() == 0)
+    return false;
+
+  // orthonormal frame (o,u,v) of the plane, with u x v = n
+  mat<3, 3, T> R = flatten_rotation(plane.n);
+  const vec o = plane.p;
+  const vec u(R._vec[0], R._vec[1], R._vec[2]);
+  vec v(R._vec[3], R._vec[4], R._vec[5]);
+  if (u.cross(v).dot(plane.n) < 0)
+    v = -v;
+
+  // half-plane with the inside on the left of its direction
+  struct HalfPlane {
+    vec2 p, dir;
+    T angle;
+  };
+  auto cross = [](const vec2 &a, const vec2 &b) {
+    return a.x() * b.y() - a.y() * b.x();
+  };
+  auto out = [&](const HalfPlane &h, const vec2 &r) {
+    return cross(h.dir, r - h.p) < -TOLL;
+  };
+  auto intersection = [&](const HalfPlane &h, const HalfPlane &k) {
+    return h.p + h.dir * (cross(k.p - h.p, k.dir) / cross(h.dir, k.dir));
+  };
+  // k, next to j in the deque, is redundant after h if their vertex is
+  // outside h or, for nearly parallel h and k, if h crosses k before it
+  // (within the tolerance of h, the vertex of h and k could be far away along
+  // k, beyond the vertex of j and k)
+  auto redundant_back = [&](const HalfPlane &h, const HalfPlane &j,
+                            const HalfPlane &k) { // k after j
+    vec2 q = intersection(j, k);
+    return out(h, q) || (cross(k.dir, h.dir) > TOLL &&
+                         (intersection(k, h) - q).dot(k.dir) < -TOLL);
+  };
+  auto redundant_front = [&](const HalfPlane &h, const HalfPlane &j,
+                             const HalfPlane &k) { // k before j
+    vec2 q = intersection(k, j);
+    return out(h, q) || (cross(h.dir, k.dir) > TOLL &&
+                         (q - intersection(h, k)).dot(k.dir) < -TOLL);
+  };
+  std::vector<HalfPlane> H;
+  H.reserve(faces.size() + 4);
+  // inside is n.x >= d, i.e. a*s + b*t >= c in the frame
+  auto add = [&](const vec &n, const T d) {
+    T a = n.dot(u), b = n.dot(v), c = d - n.dot(o);
+    T len = std::sqrt(a * a + b * b);
+    if (len < TOLL) // parallel to the plane: all inside or all outside
+      return c <= TOLL;
+    HalfPlane h;
+    h.dir = vec2(b / len, -a / len);
+    h.p = vec2(a, b) * (c / (len * len));
+    h.angle = std::atan2(h.dir.y(), h.dir.x());
+    if (h.angle < -M_PI + TOLL) // with those near pi, which are parallel
+      h.angle += 2 * M_PI;
+    H.push_back(h);
+    return true;
+  };
+
+  // the mesh AABB bounds the section, which keeps the intersection bounded
+  vec min(INF, INF, INF);
+  vec max(-INF, -INF, -INF);
+  for (const vec &p : verts) {
+    min = min.min(p);
+    max = max.max(p);
+  }
+  T lo[2] = {INF, INF}, hi[2] = {-INF, -INF};
+  for (uint i = 0; i < 8; i++) {
+    vec corner((i & 1) ? max.x() : min.x(), (i & 2) ? max.y() : min.y(),
+               (i & 4) ? max.z() : min.z());
+    T st[2] = {(corner - o).dot(u), (corner - o).dot(v)};
+    for (uint j = 0; j < 2; j++) {
+      lo[j] = std::min(lo[j], st[j]);
+      hi[j] = std::max(hi[j], st[j]);
+    }
+  }
+  for (uint j = 0; j < 2; j++) {
+    add(j == 0 ? u : v, lo[j] + (j == 0 ? u : v).dot(o));
+    add(j == 0 ? -u : -v, -hi[j] - (j == 0 ? u : v).dot(o));
+  }
+
+  for (uint fid = 0; fid < faces.size(); fid++) {
+    const std::vector<uint> &f = faces.at(fid);
+    if (f.size() < 3 || normals.at(fid).is_deg())
+      continue;
+    // the plane of ExtendedPlane(p, -normal), as in compute, without its
+    // sample points (which would be allocated for each face at each call)
+    vec n = -normals.at(fid);
+    n.normalize();
+    if (!add(n, n.dot(verts.at(f.front()))))
+      return false;
+  }
+
+  // half-plane intersection: the half-planes sorted by angle are pushed on a
+  // deque, popping those that become redundant at either end
+  std::sort(H.begin(), H.end(), [](const HalfPlane &h, const HalfPlane &k) {
+    return h.angle < k.angle;
+  });
+  std::deque<HalfPlane> dq;
+  for (const HalfPlane &h : H) {
+    while (dq.size() > 1 &&
+           redundant_back(h, dq.at(dq.size() - 2), dq.at(dq.size() - 1)))
+      dq.pop_back();
+    while (dq.size() > 1 && redundant_front(h, dq.at(1), dq.at(0)))
+      dq.pop_front();
+    if (!dq.empty() && fabs(cross(h.dir, dq.back().dir)) < TOLL) {
+      if (h.dir.dot(dq.back().dir) < 0)
+        return false; // opposite, and not overlapping since not popped
+      if (!out(h, dq.back().p))
+        continue; // parallel and less restrictive
+      dq.pop_back();
+    }
+    dq.push_back(h);
+  }
+  while (dq.size() > 2 && redundant_back(dq.front(), dq.at(dq.size() - 2),
+                                         dq.at(dq.size() - 1)))
+    dq.pop_back();
+  while (dq.size() > 2 && redundant_front(dq.back(), dq.at(1), dq.at(0)))
+    dq.pop_front();
+  if (dq.size() < 3)
+    return false;
+  // a bounded intersection turns left at every vertex; otherwise it is empty,
+  // and the deque is left with a chain of half-planes that do not close
+  for (uint i = 0; i < dq.size(); i++)
+    if (cross(dq.at(i).dir, dq.at((i + 1) % dq.size()).dir) <= 0)
+      return false;
+
+  for (uint i = 0; i < dq.size(); i++) {
+    vec2 q = intersection(dq.at(i), dq.at((i + 1) % dq.size()));
+    vec p = o + u * q.x() + v * q.y();
+    if (polygon.empty() || polygon.back().dist(p) > TOLL)
+      polygon.push_back(p);
+  }
+  if (polygon.size() > 1 && polygon.front().dist(polygon.back()) <= TOLL)
+    polygon.pop_back();
+  if (polygon.size() < 3) {
+    polygon.clear();
+    return false;
+  }
+  return true;
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+template <class T>
+template <class V>
+CINO_INLINE bool PolyhedronKernel<T>::clip(const ExtendedPlane<T> &plane,
+                                           const V &plane_verts,
+                                           const int plane_id) {
+  KERNEL_MEMORY_PHASE(PHASE_CLASSIFY);
+  std::vector<INTERSECTION_TYPE> v_sign(kernel_verts.size());
+  parallel_chunks(
+      kernel_verts.size(),
+      num_chunks(kernel_verts.size(), parallel_threshold),
+      [&](uint, uint begin, uint end) {
+        for (uint vid = begin; vid < end; vid++) {
+          if (find_v(plane_verts.cbegin(), plane_verts.cend(),
+                     kernel_verts.at(vid)) != plane_verts.cend())
+            v_sign.at(vid) = INTERSECT;
+          else
+            v_sign.at(vid) = contains(plane, kernel_verts.at(vid));
+        }
+      });
+  if (std::find(v_sign.cbegin(), v_sign.cend(), BELOW) == v_sign.cend())
+    return true; // the plane does not cut the kernel
+  num_clips++;
+  if (output_half_spaces && plane_id >= 0) {
+    KernelHalfSpace &h = cut_planes[plane_id];
+    h.face_id = plane_id;
+    h.normal = -to_vec3d(plane.n); // the kernel is above the plane
+    h.offset = h.normal.dot(to_vec3d(plane.p));
+  }
+  if (!kernel_incidence.empty()) {
+    incidence_plane_intersection(v_sign, plane, plane_id);
+    if (kernel_verts.size() >= 4)
+      return true;
+  } else {
+    polyhedron_plane_intersection(kernel_verts, v_sign, kernel_faces,
+                                  kernel_face_planes, plane, plane_id);
+    if (kernel_verts.size() >= 3 && kernel_faces.size() >= 3)
+      return true;
+  }
+  kernel_verts.clear();
+  kernel_faces.clear();
+  kernel_face_planes.clear();
+  kernel_incidence.clear();
+  incidence_planes.clear();
+  return false;
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+template <class T>
+template <uint N, class M>
+CINO_INLINE bool PolyhedronKernel<T>::clip_face(const M &mesh, const uint fid) {
+  auto clip_verts = [&](const auto &v) {
+    const vec n = to_vec(mesh.normal(fid));
+    if (v.size() == 0 || v[0].is_nan() || v[0].is_inf() || n.is_deg()) {
+      std::cout << "WARNING: skipping degenerate face." << std::endl;
+      return true;
+    }
+    return clip(ExtendedPlane<T>(v[0], -n), v, fid);
+  };
+  if constexpr (N == 0) {
+    plane_verts.resize(mesh.face_size(fid));
+    for (uint i = 0; i < plane_verts.size(); i++)
+      plane_verts[i] = to_vec(mesh.vert(mesh.face_vert(fid, i)));
+    return clip_verts(plane_verts);
+  } else {
+    std::array<vec, N> v;
+    for (uint i = 0; i < N; i++)
+      v[i] = to_vec(mesh.vert(mesh.face_vert(fid, i)));
+    return clip_verts(v);
+  }
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+template <class T>
+CINO_INLINE
+void PolyhedronKernel<T>::polyhedron_plane_intersection(
+    std::vector<vec> &verts, const std::vector<INTERSECTION_TYPE> &v_sign,
+    std::vector<std::vector<uint>> &faces, std::vector<int> &face_planes,
+    const ExtendedPlane<T> &plane, const int plane_id) {
+  KERNEL_MEMORY_PHASE(PHASE_CLIP);
+  // 1) clip each face independently, possibly in parallel: each chunk of
+  // faces writes the surviving polygons in its own flat buffer
+  struct ClippedFaces {
+    std::vector<vec> v;                // polygon vertices
+    std::vector<INTERSECTION_TYPE> s;    // and their signs
+    std::vector<uint> id;                // and ids (valid if ABOVE)
+    std::vector<uint> offset = {0};      // polygon i is [offset[i],offset[i+1])
+    std::vector<INTERSECTION_TYPE> type; // ABOVE or INTERSECT
+    std::vector<int> plane;              // supporting plane
+  };
+  uint n_chunks = num_chunks(faces.size(), parallel_threshold);
+  std::vector<ClippedFaces> chunks(n_chunks);
+  parallel_chunks(faces.size(), n_chunks, [&](uint c, uint begin, uint end) {
+    ClippedFaces &out = chunks.at(c);
+    for (uint fid = begin; fid < end; fid++) {
+      std::vector<uint> f = faces.at(fid);
+      std::vector<INTERSECTION_TYPE> fs(f.size());
+      for (uint vid = 0; vid < f.size(); vid++)
+        fs.at(vid) = v_sign.at(f.at(vid));
+      INTERSECTION_TYPE type = classify(fs);
+      if (type == BELOW) // face strictly below the plane
+        continue;
+      std::vector<vec> fv(f.size());
       for (uint vid = 0; vid < f.size(); vid++)
         fv.at(vid) = verts.at(f.at(vid));
-      polygon_plane_intersection(fv, fs, f, plane);
-      for (uint i = 0; i < f.size(); i++) {
-        auto it = find_v(above_v.begin(), above_v.end(), fv.at(i));
-        if (it == above_v.end()) {
-          above_v.push_back(fv.at(i));
-          above_s.push_back(fs.at(i));
-          f.at(i) = above_v.size() - 1;
-        } else
-          f.at(i) = it - above_v.cbegin();
-      }
-      add_face(f, above_f);
-      break;
+      if (type == INTERSECT) // face properly intersects the plane
+        polygon_plane_intersection(fv, fs, f, plane);
+      out.v.insert(out.v.end(), fv.begin(), fv.end());
+      out.s.insert(out.s.end(), fs.begin(), fs.end());
+      out.id.insert(out.id.end(), f.begin(), f.end());
+      out.offset.push_back(out.v.size());
+      out.type.push_back(type);
+      out.plane.push_back(face_planes.at(fid));
     }
-    default:
-      break;
+  });
+
+  // 2) compact the chunks into a single buffer, at offsets given by the
+  // prefix sums of the chunk sizes
+  ClippedFaces clipped;
+  if (n_chunks == 1)
+    clipped = std::move(chunks.front());
+  else {
+    std::vector<uint> v_offset(n_chunks + 1, 0), f_offset(n_chunks + 1, 0);
+    for (uint c = 0; c < n_chunks; c++) {
+      v_offset.at(c + 1) = v_offset.at(c) + chunks.at(c).v.size();
+      f_offset.at(c + 1) = f_offset.at(c) + chunks.at(c).type.size();
     }
+    clipped.v.resize(v_offset.back());
+    clipped.s.resize(v_offset.back());
+    clipped.id.resize(v_offset.back());
+    clipped.offset.resize(f_offset.back() + 1);
+    clipped.type.resize(f_offset.back());
+    clipped.plane.resize(f_offset.back());
+    parallel_chunks(n_chunks, n_chunks, [&](uint c, uint, uint) {
+      const ClippedFaces &in = chunks.at(c);
+      std::copy(in.v.begin(), in.v.end(), clipped.v.begin() + v_offset.at(c));
+      std::copy(in.s.begin(), in.s.end(), clipped.s.begin() + v_offset.at(c));
+      std::copy(in.id.begin(), in.id.end(),
+                clipped.id.begin() + v_offset.at(c));
+      std::copy(in.type.begin(), in.type.end(),
+                clipped.type.begin() + f_offset.at(c));
+      std::copy(in.plane.begin(), in.plane.end(),
+                clipped.plane.begin() + f_offset.at(c));
+      for (uint i = 1; i < in.offset.size(); i++)
+        clipped.offset.at(f_offset.at(c) + i) =
+            v_offset.at(c) + in.offset.at(i);
+    });
+  }
+
+  // 3) merge coincident vertices and assemble the faces, in the input order.
+  // Vertices above the plane keep their identity, only those on the plane
+  // (old, or created by the cut) are merged, with each other
+  const uint NONE = std::numeric_limits<uint>::max();
+  std::vector<vec> above_v;
+  std::vector<std::vector<uint>> above_f;
+  std::vector<int> above_p;
+  std::vector<uint> new_vid(verts.size(), NONE);
+  std::vector<vec> cap_v;     // vertices on the plane
+  std::vector<uint> cap_vids; // and their ids in above_v
+  for (uint i = 0; i < clipped.type.size(); i++) {
+    std::vector<uint> f;
+    for (uint j = clipped.offset.at(i); j < clipped.offset.at(i + 1); j++) {
+      if (clipped.s.at(j) == ABOVE) {
+        uint &vid = new_vid.at(clipped.id.at(j));
+        if (vid == NONE) {
+          vid = above_v.size();
+          above_v.push_back(clipped.v.at(j));
+        }
+        f.push_back(vid);
+        continue;
+      }
+      auto it = find_v(cap_v.begin(), cap_v.end(), clipped.v.at(j));
+      if (it == cap_v.end()) {
+        cap_v.push_back(clipped.v.at(j));
+        cap_vids.push_back(above_v.size());
+        above_v.push_back(clipped.v.at(j));
+        f.push_back(above_v.size() - 1);
+      } else
+        f.push_back(cap_vids.at(it - cap_v.begin()));
+    }
+    if (clipped.type.at(i) == ABOVE) { // face weakly above the plane
+      above_f.push_back(f);
+      above_p.push_back(clipped.plane.at(i));
+    } else if (add_face(f, above_f))
+      above_p.push_back(clipped.plane.at(i));
   }
   verts = above_v;
   faces = above_f;
+  face_planes = above_p;
+  clip_new_vid.swap(new_vid);
 
-  std::vector<vec3d> cap_v; // generate the cap face
-  std::vector<uint> cap_vids;
-  for (uint vid = 0; vid < above_v.size(); vid++)
-    if (above_s.at(vid) == INTERSECT) {
-      cap_vids.push_back(vid);
-      cap_v.push_back(above_v.at(vid));
-    }
-  if (cap_v.size() < 3)
+  KERNEL_MEMORY_PHASE(PHASE_CAP);
+  if (cap_v.size() < 3) // generate the cap face
     return;
   std::vector<uint> cap_f(cap_v.size());
   std::vector<uint> tmp_f = sort_points(cap_v, plane);
   for (uint i = 0; i < tmp_f.size(); i++)
     cap_f.at(i) = cap_vids.at(tmp_f.at(i));
-  add_face(cap_f, faces);
+  if (add_face(cap_f, faces))
+    face_planes.push_back(plane_id);
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+template <class T>
+CINO_INLINE
+void PolyhedronKernel<T>::incidence_plane_intersection(
+    const std::vector<INTERSECTION_TYPE> &v_sign, const ExtendedPlane<T> &plane,
+    const int plane_id) {
+  KERNEL_MEMORY_PHASE(PHASE_CLIP);
+  const uint NONE = std::numeric_limits<uint>::max();
+  const uint h = incidence_planes.size();
+  incidence_planes.push_back(plane_id);
+  plane_marks.resize(incidence_planes.size(), 0);
+  auto key = [](uint a, uint b) { return uint64_t(a) << 32 | b; };
+
+  // 1) the lines (pairs of planes) through the removed vertices, and the kept
+  // vertices on them: a removed and a kept vertex on a common line are the
+  // ends of an edge, or of a chain of aligned edges
+  std::unordered_map<uint64_t, std::vector<uint>> lines;
+  std::vector<uint> marked;
+  for (uint vid = 0; vid < kernel_verts.size(); vid++) {
+    if (v_sign.at(vid) != BELOW)
+      continue;
+    const std::vector<uint> &inc = kernel_incidence.at(vid);
+    for (uint i = 0; i < inc.size(); i++) {
+      if (!plane_marks.at(inc.at(i))) {
+        plane_marks.at(inc.at(i)) = 1;
+        marked.push_back(inc.at(i));
+      }
+      for (uint j = i + 1; j < inc.size(); j++)
+        lines[key(inc.at(i), inc.at(j))].push_back(vid);
+    }
+  }
+  for (uint vid = 0; vid < kernel_verts.size(); vid++) {
+    if (v_sign.at(vid) == BELOW)
+      continue;
+    const std::vector<uint> &inc = kernel_incidence.at(vid);
+    uint n_marked = 0;
+    for (uint p : inc)
+      n_marked += plane_marks.at(p);
+    if (n_marked < 2)
+      continue;
+    for (uint i = 0; i < inc.size(); i++)
+      for (uint j = i + 1; j < inc.size(); j++)
+        if (plane_marks.at(inc.at(i)) && plane_marks.at(inc.at(j))) {
+          auto it = lines.find(key(inc.at(i), inc.at(j)));
+          if (it != lines.end())
+            it->second.push_back(vid);
+        }
+  }
+  for (uint p : marked)
+    plane_marks.at(p) = 0;
+
+  // 2) new vertices where the edges from a removed vertex to a vertex above
+  // the plane cross it, on the planes common to the two
+  std::vector<vec> new_verts;
+  std::vector<std::vector<uint>> new_inc;
+  std::unordered_map<uint64_t, uint> cut_edges;
+  auto cut = [&](uint below, uint above) {
+    if (!cut_edges.emplace(key(below, above), 0).second)
+      return; // already cut, through another pair of its planes
+    new_verts.push_back(line_plane_intersection(
+        kernel_verts.at(above), kernel_verts.at(below), plane));
+    const std::vector<uint> &a = kernel_incidence.at(above);
+    const std::vector<uint> &b = kernel_incidence.at(below);
+    std::vector<uint> inc;
+    std::set_intersection(a.begin(), a.end(), b.begin(), b.end(),
+                          std::back_inserter(inc));
+    inc.push_back(h);
+    new_inc.push_back(inc);
+  };
+  for (auto &line : lines) {
+    std::vector<uint> &l = line.second;
+    if (l.size() > 2)
+      sort_along_line(l);
+    for (uint i = 0; i + 1 < l.size(); i++) {
+      INTERSECTION_TYPE s0 = v_sign.at(l.at(i)), s1 = v_sign.at(l.at(i + 1));
+      if (s0 == BELOW && s1 == ABOVE)
+        cut(l.at(i), l.at(i + 1));
+      else if (s0 == ABOVE && s1 == BELOW)
+        cut(l.at(i + 1), l.at(i));
+    }
+  }
+
+  // 3) the vertices on the plane get it in their incidences, and lose the
+  // planes left without vertices above it (which now meet the kernel in an
+  // edge, or coincide with the new face)
+  for (uint vid = 0; vid < kernel_verts.size(); vid++)
+    if (v_sign.at(vid) == INTERSECT)
+      for (uint p : kernel_incidence.at(vid))
+        if (!plane_marks.at(p)) {
+          plane_marks.at(p) = 1;
+          marked.push_back(p);
+        }
+  if (!marked.empty()) {
+    for (uint vid = 0; vid < kernel_verts.size(); vid++)
+      if (v_sign.at(vid) == ABOVE)
+        for (uint p : kernel_incidence.at(vid))
+          if (plane_marks.at(p) == 1)
+            plane_marks.at(p) = 2;
+    for (uint vid = 0; vid < kernel_verts.size(); vid++)
+      if (v_sign.at(vid) == INTERSECT) {
+        std::vector<uint> &inc = kernel_incidence.at(vid);
+        inc.erase(std::remove_if(inc.begin(), inc.end(),
+                                 [&](uint p) { return plane_marks.at(p) == 1; }),
+                  inc.end());
+        inc.push_back(h);
+      }
+    for (uint p : marked)
+      plane_marks.at(p) = 0;
+  }
+
+  // 4) compact the kept vertices, followed by the new ones
+  clip_new_vid.assign(kernel_verts.size(), NONE);
+  uint n = 0;
+  for (uint vid = 0; vid < kernel_verts.size(); vid++) {
+    if (v_sign.at(vid) == BELOW)
+      continue;
+    if (v_sign.at(vid) == ABOVE)
+      clip_new_vid.at(vid) = n;
+    if (n != vid) {
+      kernel_verts.at(n) = kernel_verts.at(vid);
+      kernel_incidence.at(n).swap(kernel_incidence.at(vid));
+    }
+    n++;
+  }
+  kernel_verts.resize(n);
+  kernel_incidence.resize(n);
+  kernel_verts.insert(kernel_verts.end(), new_verts.begin(), new_verts.end());
+  for (std::vector<uint> &inc : new_inc)
+    kernel_incidence.push_back(std::move(inc));
 }
 
 //::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
 
+template <class T>
 CINO_INLINE
-void PolyhedronKernel::polygon_plane_intersection(
-    std::vector<vec3d> &verts, std::vector<INTERSECTION_TYPE> &v_sign,
-    std::vector<uint> &face, const ExtendedPlane &plane) {
-  std::vector<vec3d> above_v;
+void PolyhedronKernel<T>::polygon_plane_intersection(
+    std::vector<vec> &verts, std::vector<INTERSECTION_TYPE> &v_sign,
+    std::vector<uint> &face, const ExtendedPlane<T> &plane) {
+  std::vector<vec> above_v;
   std::vector<INTERSECTION_TYPE> above_s;
   std::vector<uint> above_f;
   uint last = *std::max_element(face.cbegin(), face.cend());
 
   for (uint eid = 0; eid < face.size(); eid++) {
     uint vid1 = face.at((eid + 1) % face.size());
-    vec3d v1 = verts.at((eid + 1) % verts.size());
+    vec v1 = verts.at((eid + 1) % verts.size());
     INTERSECTION_TYPE vs0 = v_sign.at(eid);
     INTERSECTION_TYPE vs1 = v_sign.at((eid + 1) % v_sign.size());
     switch (classify({vs0, vs1})) {
@@ -175,7 +2187,7 @@ void PolyhedronKernel::polygon_plane_intersection(
       break;
     }
     case INTERSECT: { // edge properly intersects the plane
-      vec3d v = line_plane_intersection(verts.at(eid), v1, plane);
+      vec v = line_plane_intersection(verts.at(eid), v1, plane);
       last++;
       above_v.push_back(v);
       above_s.push_back(INTERSECT);
@@ -199,22 +2211,24 @@ void PolyhedronKernel::polygon_plane_intersection(
 
 //::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
 
+template <class T>
 CINO_INLINE
-vec3d PolyhedronKernel::line_plane_intersection(const vec3d &v0,
-                                                const vec3d &v1,
-                                                const ExtendedPlane &plane) {
-  vec3d p = v0.dist(plane.p) > TOLL ? plane.p : plane.points.at(1);
-  double N = plane.n.dot(v0 - p);
-  double D = plane.n.dot(v1 - v0);
+mat<3, 1, T>
+PolyhedronKernel<T>::line_plane_intersection(const vec &v0, const vec &v1,
+                                             const ExtendedPlane<T> &plane) {
+  vec p = v0.dist(plane.p) > TOLL ? plane.p : plane.points.at(1);
+  T N = plane.n.dot(v0 - p);
+  T D = plane.n.dot(v1 - v0);
   assert(fabs(D) > TOLL);
   return v0 - N / D * (v1 - v0);
 }
 
 //::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
 
+template <class T>
 CINO_INLINE
-PolyhedronKernel::INTERSECTION_TYPE
-PolyhedronKernel::classify(const std::vector<INTERSECTION_TYPE> &sign) {
+typename PolyhedronKernel<T>::INTERSECTION_TYPE
+PolyhedronKernel<T>::classify(const std::vector<INTERSECTION_TYPE> &sign) {
   int size = sign.size();
   assert(size > 1);
   switch (size) {
@@ -241,3 +2255,64 @@ PolyhedronKernel::classify(const std::vector<INTERSECTION_TYPE> &sign) {
   }
   }
 }
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+// eigenvectors of the symmetric matrix C (cyclic Jacobi rotations), sorted by
+// decreasing eigenvalue
+template <class T>
+CINO_INLINE
+void PolyhedronKernel<T>::principal_axes(double C[3][3], vec3d axes[3]) {
+  double V[3][3] = {{1, 0, 0}, {0, 1, 0}, {0, 0, 1}};
+  for (uint sweep = 0; sweep < 50; sweep++) {
+    double off = fabs(C[0][1]) + fabs(C[0][2]) + fabs(C[1][2]);
+    if (off < 1e-15 * (fabs(C[0][0]) + fabs(C[1][1]) + fabs(C[2][2])))
+      break;
+    for (uint p = 0; p < 2; p++)
+      for (uint q = p + 1; q < 3; q++) {
+        if (C[p][q] == 0)
+          continue;
+        double theta = (C[q][q] - C[p][p]) / (2 * C[p][q]);
+        double t = (theta >= 0 ? 1.0 : -1.0) /
+                   (fabs(theta) + sqrt(theta * theta + 1));
+        double c = 1 / sqrt(t * t + 1), s = t * c;
+        for (uint k = 0; k < 3; k++) { // C = C * R
+          double ckp = C[k][p], ckq = C[k][q];
+          C[k][p] = c * ckp - s * ckq;
+          C[k][q] = s * ckp + c * ckq;
+        }
+        for (uint k = 0; k < 3; k++) { // C = R^T * C
+          double cpk = C[p][k], cqk = C[q][k];
+          C[p][k] = c * cpk - s * cqk;
+          C[q][k] = s * cpk + c * cqk;
+        }
+        for (uint k = 0; k < 3; k++) { // V = V * R
+          double vkp = V[k][p], vkq = V[k][q];
+          V[k][p] = c * vkp - s * vkq;
+          V[k][q] = s * vkp + c * vkq;
+        }
+      }
+  }
+  uint order[3] = {0, 1, 2};
+  std::sort(order, order + 3,
+            [&](uint i, uint j) { return C[i][i] > C[j][j]; });
+  for (uint i = 0; i < 3; i++)
+    axes[i] = vec3d(V[0][order[i]], V[1][order[i]], V[2][order[i]]);
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+#ifdef CINO_STATIC_LIB
+template class PolyhedronKernel<float>;
+template class PolyhedronKernel<double>;
+#define KERNEL_MESH_VIEW_INSTANCES(T, S)                                       \
+  template void PolyhedronKernel<T>::initialize(const MeshView<S> &,          \
+                                                const SEED_TYPE &);            \
+  template void PolyhedronKernel<T>::compute(                                  \
+      const MeshView<S> &, KernelMetrics *, const ComputeBudget *);
+KERNEL_MESH_VIEW_INSTANCES(float, float)
+KERNEL_MESH_VIEW_INSTANCES(float, double)
+KERNEL_MESH_VIEW_INSTANCES(double, float)
+KERNEL_MESH_VIEW_INSTANCES(double, double)
+#undef KERNEL_MESH_VIEW_INSTANCES
+#endif
@@ -2,34 +2,339 @@
 #define POLYHEDRON_KERNEL_H
 
 #include "extendedplane.h"
+#include "memory_profile.h"
+#include "mesh_view.h"
+#include "parallel_chunks.h"
+#include "plane_hierarchy.h"
+#include "seidel_lp.h"
 #include "sort_points.h"
 #include <cinolib/cino_inline.h>
 #include <cinolib/meshes/meshes.h>
 #include <cinolib/min_max_inf.h>
 #include <cinolib/predicates.h>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <queue>
+#include <random>
+#include <thread>
+#include <unordered_map>
 
 using namespace cinolib;
 
-class PolyhedronKernel {
+// integral quantities of the kernel, computed from its boundary (always in
+// double precision)
+struct KernelMetrics {
+  double volume = 0;
+  vec3d centroid = vec3d(0, 0, 0);
+  vec3d bbox_min = vec3d(0, 0, 0);
+  vec3d bbox_max = vec3d(0, 0, 0);
+};
+
+// half-space n.dot(x) <= offset of the H-representation of the kernel, with
+// n the outward unit normal. face_id is the input face whose plane bounds
+// it, or -1 for the planes of the initial box and for approximate planes
+struct KernelHalfSpace {
+  int face_id = -1;
+  vec3d normal = vec3d(0, 0, 0);
+  double offset = 0;
+};
+
+// time budget of compute: clipping stops when the deadline passes or when
+// cancel is set (possibly from another thread). The kernel is then an outer
+// approximation of the exact one, since only part of the planes was applied
+struct ComputeBudget {
+  std::chrono::steady_clock::time_point deadline =
+      std::chrono::steady_clock::time_point::max();
+  std::atomic<bool> cancel{false};
+  // called after each plane, with the planes applied so far and their total
+  std::function<void(uint, uint)> progress;
+
+  bool expired() const {
+    return cancel.load(std::memory_order_relaxed) ||
+           std::chrono::steady_clock::now() >= deadline;
+  }
+};
+
+// version of the kernel algorithm, part of the key of cached kernels (see
+// kernel_cache.h). Bump it whenever the output of compute changes
+static const uint KERNEL_ALGORITHM_VERSION = 3;
+
+// kernel computation with scalar type T (float or double). Tolerances are
+// chosen per type, see ScalarTolerance in extendedplane.h
+
+template <class T = double> class PolyhedronKernel {
 
 public:
-  std::vector<vec3d> kernel_verts;
+  typedef mat<3, 1, T> vec;
+
+  std::vector<vec> kernel_verts;
   std::vector<std::vector<uint>> kernel_faces;
+  // for each kernel face, the input face whose plane supports it (-1 for the
+  // faces of the initial box and for approximate planes)
+  std::vector<int> kernel_face_planes;
+  uint num_clips = 0; // planes that actually cut the kernel in the last run
+  uint num_unapplied = 0; // planes skipped when the last run was stopped
+  // kernel size (verts or faces) above which the classification and face
+  // clipping loops of a single clip run in parallel
+  uint parallel_threshold = 10000;
+  // number of faces above which compute visits the planes through a
+  // PlaneHierarchy, skipping the groups of planes that cannot cut the kernel
+  uint hierarchy_threshold = 100000;
+  // number of cuts between two calls of simplify during compute (0: never),
+  // and the distance within which simplify welds vertices and merges faces
+  uint simplify_interval = 0;
+  T simplify_toll = ScalarTolerance<T>::kernel;
+  // vertices and faces removed by simplify in the last run
+  uint num_simplified_verts = 0;
+  uint num_simplified_faces = 0;
+  // when set, compute tracks the kernel in incidence mode (see to_incidence)
+  // and assembles kernel_faces only once, at the end
+  bool lazy_faces = false;
+  // incidence mode: for each kernel vertex, the sorted ids of the planes
+  // through it. Plane i supports input face incidence_planes[i] (-1 for the
+  // faces of the initial box and for approximate planes)
+  std::vector<std::vector<uint>> kernel_incidence;
+  std::vector<int> incidence_planes;
+  // when set, compute also fills kernel_half_spaces: one half-space for each
+  // kernel face, i.e. the minimal set of planes whose intersection is the
+  // kernel, sorted by input face. Planes are recorded when they cut the
+  // kernel, so they are the exact ones used for clipping
+  bool output_half_spaces = false;
+  std::vector<KernelHalfSpace> kernel_half_spaces;
+  // faces picked exactly by the farthest-first orders of compute_race
+  uint race_max_picks = 1024;
+
+  enum SEED_TYPE {
+    SEED_AABB = 0, // axis aligned bounding box
+    SEED_OBB = 1,  // principal axes bounding box, if smaller than the AABB
+  };
 
   CINO_INLINE
   explicit PolyhedronKernel() {}
 
   CINO_INLINE
-  void initialize(const std::vector<vec3d> &verts);
+  void initialize(const std::vector<vec> &verts,
+                  const SEED_TYPE &seed = SEED_AABB);
+
+  // as above, reading the vertices in place from a caller-owned buffer
+  template <class S>
+  CINO_INLINE void initialize(const MeshView<S> &mesh,
+                              const SEED_TYPE &seed = SEED_AABB);
+
+  // linear time convexity test: convex meshes are their own kernel, and
+  // compute returns them without clipping
+  CINO_INLINE
+  bool is_convex(const std::vector<vec> &verts,
+                 const std::vector<std::vector<uint>> &faces,
+                 const std::vector<vec> &normals) const;
 
+  // clips the initial kernel with the face planes. With a budget, the
+  // computation may stop early, see ComputeBudget and num_unapplied
   CINO_INLINE
-  void compute(const std::vector<vec3d> &verts,
+  void compute(const std::vector<vec> &verts,
                const std::vector<std::vector<uint>> &faces,
-               const std::vector<vec3d> &normals,
-               const bool &shuffle = false);
+               const std::vector<vec> &normals, const bool &shuffle = false,
+               KernelMetrics *metrics = nullptr,
+               const ComputeBudget *budget = nullptr);
+
+  // as above, reading the mesh in place from caller-owned buffers, with no
+  // conversion to vectors. Missing normals are computed per face
+  template <class S>
+  CINO_INLINE void compute(const MeshView<S> &mesh,
+                           KernelMetrics *metrics = nullptr,
+                           const ComputeBudget *budget = nullptr);
+
+  // orders in which compute_race applies the planes: as in the input, in a
+  // seeded random order, farthest-first over the face centroids (spread out
+  // in space), or farthest-first over the face normals (spread out in
+  // direction)
+  enum PLANE_ORDER {
+    ORDER_INPUT = 0,
+    ORDER_RANDOM = 1,
+    ORDER_FARTHEST = 2,
+    ORDER_NORMAL_SPREAD = 3,
+  };
+
+  CINO_INLINE
+  static const char *order_name(const PLANE_ORDER order);
+
+  // the faces of the mesh in the given order. Farthest-first orders are
+  // exact for the first race_max_picks faces, see farthest_first
+  CINO_INLINE
+  std::vector<uint> plane_order(const std::vector<vec> &verts,
+                                const std::vector<std::vector<uint>> &faces,
+                                const std::vector<vec> &normals,
+                                const PLANE_ORDER order, const uint seed = 0);
+
+  // as compute, clipping with the planes of the faces in order (a
+  // permutation of the faces), without the hierarchy
+  CINO_INLINE
+  void compute_ordered(const std::vector<vec> &verts,
+                       const std::vector<std::vector<uint>> &faces,
+                       const std::vector<vec> &normals,
+                       const std::vector<uint> &order,
+                       KernelMetrics *metrics = nullptr,
+                       const ComputeBudget *budget = nullptr);
+
+  // portfolio mode: runs compute_ordered with each PLANE_ORDER on its own
+  // thread, starting from copies of this kernel, keeps the kernel of the
+  // first to finish and cancels the others through a shared ComputeBudget.
+  // Returns the order that won
+  CINO_INLINE
+  PLANE_ORDER compute_race(const std::vector<vec> &verts,
+                           const std::vector<std::vector<uint>> &faces,
+                           const std::vector<vec> &normals,
+                           const uint seed = 0,
+                           KernelMetrics *metrics = nullptr,
+                           const ComputeBudget *budget = nullptr);
+
+  // randomized incremental computation with a conflict graph: each pending
+  // plane keeps a witness, a kernel vertex that is not strictly inside it, and
+  // each vertex the planes it witnesses. When a clip removes vertices, their
+  // planes look for a new witness among the vertices of the new cap face only
+  // (the vertices outside a plane form a connected subgraph of the kernel),
+  // and are discarded without clipping if there is none. Planes are inserted
+  // in a random order given by seed. The budget, lazy_faces,
+  // simplify_interval and output_half_spaces apply as in compute
+  CINO_INLINE
+  void compute_randomized(const std::vector<vec> &verts,
+                          const std::vector<std::vector<uint>> &faces,
+                          const std::vector<vec> &normals, const uint seed = 0,
+                          KernelMetrics *metrics = nullptr,
+                          const ComputeBudget *budget = nullptr);
+
+  // kernel of the next frame of a sequence of meshes with fixed connectivity.
+  // The planes that supported the kernel of the previous frame are clipped
+  // first; the others follow in their previous order, and are skipped without
+  // clipping when the AABB of the (now small) kernel lies inside them. The
+  // first frame, or a change in the number of faces, starts from the input
+  // order. lazy_faces, simplify_interval and output_half_spaces apply as in
+  // compute
+  CINO_INLINE
+  void compute_next(const std::vector<vec> &verts,
+                    const std::vector<std::vector<uint>> &faces,
+                    const std::vector<vec> &normals,
+                    KernelMetrics *metrics = nullptr);
+
+  // computes the kernel in single precision and checks it in double precision
+  // against the input planes: every kernel vertex must lie inside every face
+  // half-space and every kernel face must lie on the input plane it comes
+  // from or on the seed box. If the float kernel is suspect, the kernel is
+  // recomputed in precision T. Both start from the given seed, and use the
+  // settings and budget of this kernel; a float kernel stopped by the budget
+  // is kept unchecked. Returns true if the single precision result was kept
+  CINO_INLINE
+  bool compute_float_first(const std::vector<vec3d> &verts,
+                           const std::vector<std::vector<uint>> &faces,
+                           const std::vector<vec3d> &normals,
+                           const bool &shuffle = false,
+                           const SEED_TYPE &seed = SEED_AABB,
+                           KernelMetrics *metrics = nullptr,
+                           const ComputeBudget *budget = nullptr);
+
+  // approximate kernel: face planes whose normals and offsets agree within
+  // toll (offsets relative to the AABB diagonal) are clustered and each
+  // cluster is clipped with a single conservative plane. The planes go
+  // through compute (hierarchy, budget, lazy_faces, simplify_interval and
+  // output_half_spaces apply), and representative planes have face id -1.
+  // The result is contained in the exact kernel; returns a bound on the
+  // Hausdorff distance between the two (inf if the approximate kernel is
+  // empty, or if the budget stopped the computation)
+  CINO_INLINE
+  double compute_approximate(const std::vector<vec> &verts,
+                             const std::vector<std::vector<uint>> &faces,
+                             const std::vector<vec> &normals,
+                             const double &toll,
+                             KernelMetrics *metrics = nullptr,
+                             const ComputeBudget *budget = nullptr);
+
+  // bounded error cleanup of the kernel, meant to be run between clips:
+  // vertices within simplify_toll of each other are welded (none moves by
+  // more than simplify_toll), faces left with less than three vertices are
+  // dropped and those thinner than simplify_toll are collapsed onto a segment,
+  // adjacent faces whose vertices lie within simplify_toll of the plane of
+  // one of them are merged, and the vertices left on two faces only (hence on
+  // their common edge) are removed
+  CINO_INLINE
+  void simplify();
+
+  // switches to incidence mode: kernel_faces are replaced by the planes
+  // through each vertex, and each cut becomes a double description step,
+  // which adds a vertex where an edge between a removed and a kept vertex
+  // crosses the plane. Edges are not stored: two vertices are the ends of an
+  // edge when they share two planes, and no face loop is kept in order
+  CINO_INLINE
+  void to_incidence();
+
+  // leaves incidence mode, assembling kernel_faces and kernel_face_planes
+  // from the vertex incidences. Vertices sharing three planes (one vertex
+  // split by rounding) are merged first. Each face is chained along its
+  // edges, and sorted by angle only when its incidences are degenerate
+  CINO_INLINE
+  void assemble_faces();
+
+  // volume, centroid and AABB of the kernel, in a single pass over
+  // kernel_verts and kernel_faces
+  CINO_INLINE
+  KernelMetrics compute_metrics() const;
+
+  // centre and radius of the largest ball inscribed in the kernel (Chebyshev
+  // centre), computed as an LP over the planes of the kernel faces. Returns
+  // false if the kernel is empty.
+  CINO_INLINE
+  bool chebyshev_center(vec &center, T &radius) const;
+
+  // extents of the kernel of the mesh along each direction in dirs (a k-DOP,
+  // i.e. lo <= dir.x <= hi over the kernel), without computing the kernel:
+  // each bound is a 3D LP over the face half-spaces, solved in expected O(F)
+  // time with seidel_lp. Returns false if the kernel is empty, or if an LP
+  // fails numerically (its optimum outside the bounding box of the LP)
+  CINO_INLINE
+  static bool kernel_dop(const std::vector<vec> &verts,
+                         const std::vector<std::vector<uint>> &faces,
+                         const std::vector<vec> &normals,
+                         const std::vector<vec> &dirs, std::vector<T> &lo,
+                         std::vector<T> &hi);
+
+  // AABB of the kernel of the mesh, as the k-DOP of the three axes
+  CINO_INLINE
+  static bool kernel_aabb(const std::vector<vec> &verts,
+                          const std::vector<std::vector<uint>> &faces,
+                          const std::vector<vec> &normals, vec &min,
+                          vec &max);
+
+  // cross-section of the kernel of the mesh on plane, without computing the
+  // kernel: the half-spaces of the faces are intersected with the plane and
+  // the resulting half-planes with each other, in O(F log F). The section is
+  // a convex polygon, counterclockwise around plane.n. Returns false if it
+  // is empty (or has no area)
+  CINO_INLINE
+  static bool cross_section(const std::vector<vec> &verts,
+                            const std::vector<std::vector<uint>> &faces,
+                            const std::vector<vec> &normals,
+                            const ExtendedPlane<T> &plane,
+                            std::vector<vec> &polygon);
 
 private:
-  double TOLL = 1e-8;
+  std::vector<uint> sequence_order; // plane order for the next frame
+  std::vector<vec> plane_verts;     // face buffer reused by clip_face
+  // for each kernel vertex before the last cut or simplify, its index after
+  // it (max uint if it was removed, or lies on the cutting plane)
+  std::vector<uint> clip_new_vid;
+  std::vector<char> plane_marks; // per incidence plane, cleared after use
+  // with output_half_spaces, the planes that cut the kernel in the current
+  // run, by input face
+  std::unordered_map<int, KernelHalfSpace> cut_planes;
+
+  static constexpr T TOLL = ScalarTolerance<T>::kernel;
+  static constexpr T INF = std::numeric_limits<T>::infinity();
 
   enum INTERSECTION_TYPE {
     BELOW = -1,
@@ -37,39 +342,157 @@ private:
     ABOVE = 1,
   };
 
+  // clips the kernel with the half-space above plane. Kernel vertices that
+  // coincide with plane_verts (a std::vector, or a std::array for faces of
+  // fixed size) are considered on the plane. Returns false if the kernel
+  // becomes empty
+  template <class V>
+  CINO_INLINE bool clip(const ExtendedPlane<T> &plane, const V &plane_verts,
+                        const int plane_id = -1);
+
+  // clips the kernel with the plane of face fid of mesh, skipping degenerate
+  // faces. With N > 0 all faces have N vertices, which are gathered in a
+  // fixed-size array so that the coincidence test in clip is unrolled; with
+  // N = 0 they go through plane_verts
+  template <uint N, class M>
+  CINO_INLINE bool clip_face(const M &mesh, const uint fid);
+
+  // fills kernel_half_spaces from kernel_face_planes and cut_planes. Faces
+  // without an input plane (those of the initial box) get the plane of
+  // their vertices
+  CINO_INLINE
+  void collect_half_spaces();
+
+  // 3 or 4 if all faces of mesh are triangles or quads, 0 otherwise
+  template <class M> CINO_INLINE static uint uniform_arity(const M &mesh) {
+    if (mesh.num_faces == 0)
+      return 0;
+    const uint arity = mesh.face_size(0);
+    if (arity != 3 && arity != 4)
+      return 0;
+    for (uint fid = 1; fid < mesh.num_faces; fid++)
+      if (mesh.face_size(fid) != arity)
+        return 0;
+    return arity;
+  }
+
+  // clips with the planes of the faces, visiting them through a hierarchy:
+  // a node is skipped when its planes all contain the current kernel (tested
+  // on its bounding ball first, then on its vertices)
+  template <class M>
+  CINO_INLINE void clip_hierarchy(const M &mesh, const ComputeBudget *budget);
+
+  // implementations of initialize, is_convex and compute on a mesh accessor
+  // (MeshView or VectorMeshView)
+  template <class M>
+  CINO_INLINE void initialize_mesh(const M &mesh, const SEED_TYPE &seed);
+
+  template <class M>
+  CINO_INLINE bool is_convex_mesh(const M &mesh) const;
+
+  // start of every compute path: resets the statistics of the last run and,
+  // with lazy_faces, switches to incidence mode. Returns false if there is
+  // nothing to clip: the kernel is not initialized, or the mesh is convex
+  // and is returned as its own kernel (with its half-spaces and metrics)
+  template <class M>
+  CINO_INLINE bool start_compute(const M &mesh, KernelMetrics *metrics);
+
+  // end of every compute path: assembles the faces in incidence mode, and
+  // collects the half-spaces and the metrics
+  CINO_INLINE
+  void finish_compute(KernelMetrics *metrics);
+
+  // the planes are applied in order (input order, possibly through the
+  // hierarchy, if null). With cuts (compute_next), planes whose half-space
+  // contains the AABB of the kernel are skipped without classifying its
+  // vertices, and the planes that cut the kernel are marked
+  template <class M>
+  CINO_INLINE void compute_mesh(const M &mesh, const std::vector<uint> *order,
+                                KernelMetrics *metrics,
+                                const ComputeBudget *budget,
+                                std::vector<bool> *cuts = nullptr);
+
   CINO_INLINE
   void polyhedron_plane_intersection(
-      std::vector<vec3d> &verts, const std::vector<INTERSECTION_TYPE> &v_sign,
-      std::vector<std::vector<uint>> &faces, const ExtendedPlane &p);
+      std::vector<vec> &verts, const std::vector<INTERSECTION_TYPE> &v_sign,
+      std::vector<std::vector<uint>> &faces, std::vector<int> &face_planes,
+      const ExtendedPlane<T> &p, const int plane_id);
 
+  // double description step of clip, in incidence mode
   CINO_INLINE
-  void polygon_plane_intersection(std::vector<vec3d> &verts,
+  void incidence_plane_intersection(
+      const std::vector<INTERSECTION_TYPE> &v_sign, const ExtendedPlane<T> &p,
+      const int plane_id);
+
+  CINO_INLINE
+  void polygon_plane_intersection(std::vector<vec> &verts,
                                   std::vector<INTERSECTION_TYPE> &v_sign,
                                   std::vector<uint> &face,
-                                  const ExtendedPlane &p);
+                                  const ExtendedPlane<T> &p);
+
+  CINO_INLINE
+  static void principal_axes(double C[3][3], vec3d axes[3]);
 
   CINO_INLINE
-  vec3d line_plane_intersection(const vec3d &v0, const vec3d &v1,
-                                const ExtendedPlane &p);
+  vec line_plane_intersection(const vec &v0, const vec &v1,
+                              const ExtendedPlane<T> &p);
 
   CINO_INLINE
   INTERSECTION_TYPE classify(const std::vector<INTERSECTION_TYPE> &sign);
 
+  // appends new_f to faces, unless it is degenerate or already there
   CINO_INLINE
-  void add_face(const std::vector<uint> &new_f,
+  bool add_face(const std::vector<uint> &new_f,
                 std::vector<std::vector<uint>> &faces) {
     if (new_f.size() < 3)
-      return;
+      return false;
     std::vector<uint> tmp = SORT_VEC(new_f);
     for (const std::vector<uint> &f : faces)
       if (tmp == SORT_VEC(f))
-        return; // new_f is already in faces
+        return false; // new_f is already in faces
     faces.push_back(new_f);
+    return true;
+  }
+
+  // sorts aligned kernel vertices along their line (the axis of largest
+  // extent)
+  CINO_INLINE
+  void sort_along_line(std::vector<uint> &vids) const {
+    vec min = kernel_verts.at(vids.front()), max = min;
+    for (uint vid : vids) {
+      min = min.min(kernel_verts.at(vid));
+      max = max.max(kernel_verts.at(vid));
+    }
+    vec d = max - min;
+    uint axis = d[0] >= d[1] && d[0] >= d[2] ? 0 : (d[1] >= d[2] ? 1 : 2);
+    std::sort(vids.begin(), vids.end(), [&](uint a, uint b) {
+      return kernel_verts.at(a)[axis] < kernel_verts.at(b)[axis];
+    });
+  }
+
+  CINO_INLINE
+  static vec3d to_vec3d(const vec &v) { return vec3d(v.x(), v.y(), v.z()); }
+
+  CINO_INLINE
+  static vec to_vec(const vec3d &v) { return vec(v.x(), v.y(), v.z()); }
+
+  // side of p wrt the plane P. In double the orient3d predicate is used on
+  // the three points of P; in float these points are too coarse, and the
+  // signed distance from P is used instead, in single precision (the float
+  // kernel is checked in double by compute_float_first)
+  CINO_INLINE
+  static double side(const ExtendedPlane<double> &P, const vec3d &p) {
+    return orient3d(P.points.at(0), P.points.at(1), P.points.at(2), p);
   }
 
   CINO_INLINE
-  INTERSECTION_TYPE contains(const ExtendedPlane &P, const vec3d &p) {
-    double d = orient3d(P.points.at(0), P.points.at(1), P.points.at(2), p);
+  static float side(const ExtendedPlane<float> &P, const vec3f &p) {
+    return P.n.dot(p - P.p);
+  }
+
+  CINO_INLINE
+  INTERSECTION_TYPE contains(const ExtendedPlane<T> &P, const vec &p) {
+    double d = side(P, p);
     if (fabs(d) < TOLL)
       return INTERSECT;
     else if (d > 0)
@@ -78,10 +501,8 @@ private:
       return BELOW;
   }
 
-  CINO_INLINE
-  std::vector<vec3d>::iterator find_v(std::vector<vec3d>::iterator first,
-                                      std::vector<vec3d>::iterator last,
-                                      const vec3d &v) {
+  template <class Iterator>
+  CINO_INLINE Iterator find_v(Iterator first, Iterator last, const vec &v) {
     for (; first != last; ++first)
       if (fabs((*first).x() - v.x()) < TOLL)
         if (fabs((*first).y() - v.y()) < TOLL)
@@ -0,0 +1,137 @@
+#ifndef SEIDEL_LP_H
+#define SEIDEL_LP_H
+
+// Seidel's randomized incremental algorithm for linear programs in a small
+// number of variables (R. Seidel, "Small-dimensional linear programming and
+// convex hulls made easy", 1991). Expected running time is O(d! m) for m
+// constraints in dimension d, i.e. linear in m for the fixed dimensions
+// (d <= 4) needed by the kernel computation.
+
+#include <cinolib/cino_inline.h>
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace cinolib {
+
+static const uint LP_MAX_DIM = 4;
+
+// linear constraint a.x <= b
+struct LPConstraint {
+  double a[LP_MAX_DIM] = {0, 0, 0, 0};
+  double b = 0;
+};
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+// maximize c.x subject to the constraints H and to the artificial bounding box
+// |x_j| <= M, which keeps every subproblem bounded. Constraints are processed
+// in the given order (shuffle them before calling). Returns false if the
+// problem is infeasible.
+CINO_INLINE
+bool seidel_lp_rec(const std::vector<LPConstraint> &H, const double *c,
+                   const uint dim, const double M, const double eps,
+                   double *x) {
+  if (dim == 1) {
+    double lo = -M, hi = M;
+    for (const LPConstraint &h : H) {
+      if (fabs(h.a[0]) < eps) {
+        if (h.b < -eps)
+          return false;
+      } else if (h.a[0] > 0)
+        hi = std::min(hi, h.b / h.a[0]);
+      else
+        lo = std::max(lo, h.b / h.a[0]);
+    }
+    if (lo > hi + eps)
+      return false;
+    if (lo > hi)
+      lo = hi = 0.5 * (lo + hi);
+    x[0] = c[0] > 0 ? hi : (c[0] < 0 ? lo : std::min(std::max(0.0, lo), hi));
+    return true;
+  }
+
+  // optimum of the bounding box alone
+  for (uint j = 0; j < dim; j++)
+    x[j] = c[j] > 0 ? M : (c[j] < 0 ? -M : 0);
+
+  std::vector<LPConstraint> sub_H;
+  for (uint i = 0; i < H.size(); i++) {
+    const LPConstraint &h = H.at(i);
+    double ax = 0;
+    for (uint j = 0; j < dim; j++)
+      ax += h.a[j] * x[j];
+    if (ax <= h.b + eps)
+      continue; // current optimum still feasible
+
+    // the new optimum lies on the hyperplane h.a.x = h.b: eliminate the
+    // variable k with the largest coefficient and recurse on the previous
+    // constraints, and on the bounds of x_k, which are no longer implied by
+    // the box of the subproblem
+    uint k = 0;
+    for (uint j = 1; j < dim; j++)
+      if (fabs(h.a[j]) > fabs(h.a[k]))
+        k = j;
+    if (fabs(h.a[k]) < eps)
+      return false; // 0 <= h.b < 0
+
+    // x_k = (h.b - sum_j h.a_j x_j) / h.a_k, so that x_k <= M and -x_k <= M
+    // read -sum_j (h.a_j / h.a_k) x_j <= M - h.b / h.a_k and the opposite
+    sub_H.resize(i + 2);
+    uint jj = 0;
+    for (uint j = 0; j < dim; j++)
+      if (j != k) {
+        sub_H.at(0).a[jj] = -h.a[j] / h.a[k];
+        sub_H.at(1).a[jj++] = h.a[j] / h.a[k];
+      }
+    sub_H.at(0).b = M - h.b / h.a[k];
+    sub_H.at(1).b = M + h.b / h.a[k];
+    for (uint l = 0; l < i; l++) {
+      const LPConstraint &g = H.at(l);
+      double r = g.a[k] / h.a[k];
+      jj = 0;
+      for (uint j = 0; j < dim; j++)
+        if (j != k)
+          sub_H.at(l + 2).a[jj++] = g.a[j] - r * h.a[j];
+      sub_H.at(l + 2).b = g.b - r * h.b;
+    }
+    double sub_c[LP_MAX_DIM];
+    jj = 0;
+    for (uint j = 0; j < dim; j++)
+      if (j != k)
+        sub_c[jj++] = c[j] - c[k] / h.a[k] * h.a[j];
+
+    double y[LP_MAX_DIM];
+    if (!seidel_lp_rec(sub_H, sub_c, dim - 1, M, eps, y))
+      return false;
+
+    double xk = h.b;
+    jj = 0;
+    for (uint j = 0; j < dim; j++)
+      if (j != k) {
+        x[j] = y[jj];
+        xk -= h.a[j] * y[jj++];
+      }
+    x[k] = xk / h.a[k];
+  }
+  return true;
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+// maximize c.x subject to H, with |x_j| <= M. The constraints are shuffled
+// with a fixed seed so that results are reproducible.
+CINO_INLINE
+bool seidel_lp(std::vector<LPConstraint> H, const double *c, const uint dim,
+               const double M, double *x, const double eps = 1e-12) {
+  assert(dim >= 1 && dim <= LP_MAX_DIM);
+  std::mt19937 g(0);
+  std::shuffle(H.begin(), H.end(), g);
+  return seidel_lp_rec(H, c, dim, M, eps, x);
+}
+
+} // namespace cinolib
+
+#endif // SEIDEL_LP_H
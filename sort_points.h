@@ -6,14 +6,14 @@
 
 namespace cinolib {
 
-CINO_INLINE
-bool compare(const std::pair<uint, vec2d> &p1,
-             const std::pair<uint, vec2d> &p2) {
-  vec2d c(0, 0);
-  double a1 = atan2(p1.second.y() - c.y(), p1.second.x() - c.x());
+template <class T>
+CINO_INLINE bool compare(const std::pair<uint, mat<2, 1, T>> &p1,
+                         const std::pair<uint, mat<2, 1, T>> &p2) {
+  mat<2, 1, T> c(0, 0);
+  T a1 = atan2(p1.second.y() - c.y(), p1.second.x() - c.x());
   if (a1 <= 0)
     a1 += 2 * M_PI;
-  double a2 = atan2(p2.second.y() - c.y(), p2.second.x() - c.x());
+  T a2 = atan2(p2.second.y() - c.y(), p2.second.x() - c.x());
   if (a2 <= 0)
     a2 += 2 * M_PI;
   if (a1 != a2)
@@ -24,27 +24,38 @@ bool compare(const std::pair<uint, vec2d> &p1,
 
 //::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
 
+// rotation that takes the direction n to the z axis, so that points on a
+// plane with normal n are flattened by dropping their z coordinate. Its first
+// two rows are an orthonormal basis of the plane (for n = -z the rotation is
+// the identity, which mirrors the plane)
+template <class T>
+CINO_INLINE mat<3, 3, T> flatten_rotation(const mat<3, 1, T> &n) {
+  mat<3, 1, T> Z = mat<3, 1, T>(0, 0, 1);
+  mat<3, 1, T> axis = n.cross(Z);
+  T angle = n.angle_rad(Z);
+  return mat<3, 3, T>::ROT_3D(axis, angle);
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
 // equivalent of cinolib's 'polygon_flatten' contained in
 // geometry/polygon_utils.h using the ExtendedPlane class instead of Plane
-CINO_INLINE
-bool polygon_flatten_Ext(const std::vector<vec3d> &poly3d,
-                         std::vector<vec2d> &poly2d) {
+template <class T>
+CINO_INLINE bool polygon_flatten_Ext(const std::vector<mat<3, 1, T>> &poly3d,
+                                     std::vector<mat<2, 1, T>> &poly2d) {
   poly2d.clear();
   poly2d.reserve(poly3d.size());
 
-  ExtendedPlane best_fit(poly3d);
+  ExtendedPlane<T> best_fit(poly3d);
   if (best_fit.n.is_deg() || best_fit.n.norm() == 0)
     return false;
 
-  vec3d Z = vec3d(0, 0, 1);
-  vec3d axis = best_fit.n.cross(Z);
-  double angle = best_fit.n.angle_rad(Z);
-  mat3d R = mat3d::ROT_3D(axis, angle);
+  mat<3, 3, T> R = flatten_rotation(best_fit.n);
 
   for (auto p : poly3d) {
-    vec3d tmp = best_fit.project_onto(p);
+    mat<3, 1, T> tmp = best_fit.project_onto(p);
     tmp = R * tmp;
-    poly2d.push_back(vec2d(tmp._vec)); // will drop z
+    poly2d.push_back(mat<2, 1, T>(tmp._vec)); // will drop z
   }
   return true;
 }
@@ -52,36 +63,44 @@ bool polygon_flatten_Ext(const std::vector<vec3d> &poly3d,
 //::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
 
 // https://www.baeldung.com/cs/sort-points-clockwise
-CINO_INLINE
-std::vector<uint> sort_points(const std::vector<vec3d> &verts,
-                              const ExtendedPlane &plane) {
-  std::vector<vec2d> points;
+template <class T>
+CINO_INLINE std::vector<uint>
+sort_points(const std::vector<mat<3, 1, T>> &verts,
+            const ExtendedPlane<T> &plane) {
+  std::vector<mat<2, 1, T>> points;
   std::vector<uint> vids;
   if (!polygon_flatten_Ext(verts, points)) {
     std::cout << "WARNING: polygon_flatten(verts, points) failed!" << std::endl;
     return vids;
   }
 
-  vec2d c(0, 0); // polygon centroid
-  for (const vec2d &v : points)
+  mat<2, 1, T> c(0, 0); // polygon centroid
+  for (const mat<2, 1, T> &v : points)
     c += v;
-  c /= static_cast<double>(points.size());
-  for (vec2d &p : points)
+  c /= static_cast<T>(points.size());
+  for (mat<2, 1, T> &p : points)
     p -= c;
 
-  std::vector<std::pair<uint, vec2d>> points_map;
+  std::vector<std::pair<uint, mat<2, 1, T>>> points_map;
   for (uint vid = 0; vid < points.size(); vid++)
-    points_map.push_back(std::pair<uint, vec2d>(vid, points.at(vid)));
-  std::sort(points_map.begin(), points_map.end(), compare);
+    points_map.push_back(std::pair<uint, mat<2, 1, T>>(vid, points.at(vid)));
+  std::sort(points_map.begin(), points_map.end(), compare<T>);
   for (auto &p : points_map)
     vids.push_back(p.first);
 
   // plane points towards the interior of the element
   // I want the points to be ordered counterclockwise from outside the element
   // the normal induced by the points has to be opposite wrt the plane normal
-  vec3d u = verts.at(vids.at(1)) - verts.at(vids.at(0));
-  vec3d v = verts.at(vids.at(2)) - verts.at(vids.at(0));
-  vec3d w = u.cross(v);
+  // (Newell's normal of the whole polygon, since the first three points can
+  // be almost aligned)
+  mat<3, 1, T> w(0, 0, 0);
+  for (uint i = 0; i < vids.size(); i++) {
+    const mat<3, 1, T> &a = verts.at(vids.at(i));
+    const mat<3, 1, T> &b = verts.at(vids.at((i + 1) % vids.size()));
+    w[0] += (a[1] - b[1]) * (a[2] + b[2]);
+    w[1] += (a[2] - b[2]) * (a[0] + b[0]);
+    w[2] += (a[0] - b[0]) * (a[1] + b[1]);
+  }
   if (w.dot(plane.n) > 0)
     std::reverse(vids.begin(), vids.end());
   return vids;
@@ -0,0 +1,207 @@
+#include "kernel_archive.h"
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+// checks of the zip reader on small archives written by the test itself,
+// plain and Zip64, intact and corrupt. Returns the number of failed checks
+
+static int failures = 0;
+
+#define CHECK(cond)                                                           \
+  do {                                                                        \
+    if (!(cond)) {                                                            \
+      std::cerr << __FILE__ << ":" << __LINE__ << ": " << #cond << std::endl; \
+      failures++;                                                             \
+    }                                                                         \
+  } while (0)
+
+using namespace cinolib;
+
+static const std::string FIXTURE = "archive_tests.zip";
+
+// check value of the CRC-32 standard (the CRC of the empty string is 0)
+static const std::string CHECK_DATA = "123456789";
+static const uint32_t CHECK_CRC = 0xcbf43926;
+
+// stored entry of a fixture archive: data is what is stored, crc and size
+// what the archive records about it
+struct FixtureEntry {
+  std::string name;
+  std::string data;
+  uint32_t crc;
+  uint64_t size;
+};
+
+// appends x to s as an n byte little endian integer
+static void put(std::string &s, const uint64_t x, const uint n) {
+  for (uint i = 0; i < n; i++)
+    s.push_back(char((x >> (8 * i)) & 0xff));
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+// bytes of an archive of stored entries. With zip64 the sizes and offsets
+// are in the Zip64 extra fields and end of central directory record
+static std::string zip_bytes(const std::vector<FixtureEntry> &entries,
+                             const bool zip64) {
+  std::string zip, dir;
+  for (const FixtureEntry &e : entries) {
+    uint64_t offset = zip.size();
+    put(zip, 0x04034b50, 4);
+    put(zip, 10, 2); // version needed
+    put(zip, 0, 2);  // flags
+    put(zip, 0, 2);  // method: stored
+    put(zip, 0, 4);  // time and date
+    put(zip, e.crc, 4);
+    put(zip, e.data.size(), 4);
+    put(zip, e.data.size(), 4);
+    put(zip, e.name.size(), 2);
+    put(zip, 0, 2); // extra field
+    zip += e.name + e.data;
+
+    uint64_t saturated = zip64 ? 0xffffffff : 0;
+    put(dir, 0x02014b50, 4);
+    put(dir, 45, 2); // version made by
+    put(dir, 45, 2); // version needed
+    put(dir, 0, 2);  // flags
+    put(dir, 0, 2);  // method: stored
+    put(dir, 0, 4);  // time and date
+    put(dir, e.crc, 4);
+    put(dir, zip64 ? saturated : e.size, 4); // packed size
+    put(dir, zip64 ? saturated : e.size, 4);
+    put(dir, e.name.size(), 2);
+    put(dir, zip64 ? 28 : 0, 2); // extra field
+    put(dir, 0, 2);              // comment
+    put(dir, 0, 2);              // disk
+    put(dir, 0, 6);              // attributes
+    put(dir, zip64 ? saturated : offset, 4);
+    dir += e.name;
+    if (zip64) {
+      put(dir, 1, 2);  // Zip64 extended information
+      put(dir, 24, 2); // its size
+      put(dir, e.size, 8);
+      put(dir, e.size, 8); // packed size
+      put(dir, offset, 8);
+    }
+  }
+  uint64_t dir_offset = zip.size();
+  zip += dir;
+  if (zip64) {
+    uint64_t end64_offset = zip.size();
+    put(zip, 0x06064b50, 4);
+    put(zip, 44, 8); // size of the rest of the record
+    put(zip, 45, 2); // version made by
+    put(zip, 45, 2); // version needed
+    put(zip, 0, 8);  // disks
+    put(zip, entries.size(), 8);
+    put(zip, entries.size(), 8);
+    put(zip, dir.size(), 8);
+    put(zip, dir_offset, 8);
+    put(zip, 0x07064b50, 4);
+    put(zip, 0, 4); // disk
+    put(zip, end64_offset, 8);
+    put(zip, 1, 4); // disks
+  }
+  put(zip, 0x06054b50, 4);
+  put(zip, 0, 4); // disks
+  put(zip, zip64 ? 0xffff : entries.size(), 2);
+  put(zip, zip64 ? 0xffff : entries.size(), 2);
+  put(zip, zip64 ? 0xffffffff : dir.size(), 4);
+  put(zip, zip64 ? 0xffffffff : dir_offset, 4);
+  put(zip, 0, 2); // comment
+  return zip;
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+static void write_fixture(const std::string &bytes) {
+  std::ofstream f(FIXTURE, std::ios::binary | std::ios::trunc);
+  f.write(bytes.data(), bytes.size());
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+// the directory is parsed, entries are found by name and read back
+static void test_directory() {
+  for (bool zip64 : {false, true}) {
+    write_fixture(zip_bytes({{"a/mesh.OFF", CHECK_DATA, CHECK_CRC, 9},
+                             {"notes.txt", "", 0, 0}},
+                            zip64));
+    ZipArchive archive(FIXTURE);
+    CHECK(archive.ok());
+    if (!archive.ok())
+      continue;
+    CHECK(archive.entries().size() == 2);
+    CHECK(archive.find("a/mesh.OFF") == 0);
+    CHECK(archive.find("notes.txt") == 1);
+    CHECK(archive.find("missing.off") == -1);
+    CHECK(archive.entries().at(0).size == 9);
+    CHECK(archive.entries().at(1).offset > 0);
+    std::string data, error;
+    CHECK(archive.read(0, data, error) && data == CHECK_DATA);
+    CHECK(archive.read(1, data, error) && data.empty());
+    std::vector<std::string> inputs =
+        expand_archive_inputs({FIXTURE, "plain.off"});
+    CHECK(inputs.size() == 2 && inputs.at(0) == FIXTURE + ":a/mesh.OFF" &&
+          inputs.at(1) == "plain.off");
+  }
+  std::string archive, entry;
+  CHECK(split_archive_path("d/x.zip:a/b.off", archive, entry) &&
+        archive == "d/x.zip" && entry == "a/b.off");
+  CHECK(!split_archive_path("d/x.off", archive, entry));
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+// corrupt CRCs and sizes give an error, never a huge allocation
+static void test_corrupt() {
+  std::string data, error;
+  for (bool zip64 : {false, true}) {
+    write_fixture(zip_bytes({{"crc.off", CHECK_DATA, CHECK_CRC ^ 1, 9},
+                             {"big.off", CHECK_DATA, CHECK_CRC,
+                              zip64 ? 1ull << 50 : 0xfffffff0}},
+                            zip64));
+    ZipArchive archive(FIXTURE);
+    CHECK(archive.ok());
+    if (!archive.ok())
+      continue;
+    CHECK(!archive.read(0, data, error) && error == "CRC mismatch");
+    CHECK(!archive.read(1, data, error) && error == "truncated entry");
+  }
+
+  // central directory past the end of the file, and more entries than it
+  // can hold
+  std::string zip = zip_bytes({{"a.off", CHECK_DATA, CHECK_CRC, 9}}, false);
+  std::string bad = zip;
+  bad.replace(bad.size() - 22 + 12, 4, "\xff\xff\xff\x7f");
+  write_fixture(bad);
+  CHECK(!ZipArchive(FIXTURE).ok());
+  bad = zip;
+  bad.replace(bad.size() - 22 + 8, 4, "\xff\xff\xff\xff");
+  write_fixture(bad);
+  CHECK(!ZipArchive(FIXTURE).ok());
+
+  // the same in the Zip64 end of central directory record
+  zip = zip_bytes({{"a.off", CHECK_DATA, CHECK_CRC, 9}}, true);
+  size_t end64 = zip.size() - 22 - 20 - 56;
+  bad = zip;
+  bad.replace(end64 + 40, 8, "\0\0\0\0\0\0\x04\0", 8);
+  write_fixture(bad);
+  CHECK(!ZipArchive(FIXTURE).ok());
+  bad = zip;
+  bad.replace(end64 + 32, 8, "\0\0\0\0\0\0\x04\0", 8);
+  write_fixture(bad);
+  CHECK(!ZipArchive(FIXTURE).ok());
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+int main() {
+  test_directory();
+  test_corrupt();
+  std::remove(FIXTURE.c_str());
+  if (failures == 0)
+    std::cout << "All archive tests passed" << std::endl;
+  return failures;
+}
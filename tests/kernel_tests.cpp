@@ -0,0 +1,95 @@
+#include "polyhedron_kernel.h"
+#include <random>
+
+// checks of the kernel computations on small synthetic meshes. Returns the
+// number of failed checks
+
+static int failures = 0;
+
+#define CHECK(cond)                                                           \
+  do {                                                                        \
+    if (!(cond)) {                                                            \
+      std::cerr << __FILE__ << ":" << __LINE__ << ": " << #cond << std::endl; \
+      failures++;                                                             \
+    }                                                                         \
+  } while (0)
+
+// star-shaped polyhedron: a triangulated UV sphere whose vertices are at
+// random distances from the origin, so that its kernel is a proper subset
+// of it bounded by many planes
+static void star_mesh(const uint seed, std::vector<vec3d> &verts,
+                      std::vector<std::vector<uint>> &faces,
+                      std::vector<vec3d> &normals) {
+  const uint rings = 8, sectors = 12;
+  std::mt19937 g(seed);
+  std::uniform_real_distribution<double> radius(0.7, 1.0);
+  verts.push_back(vec3d(0, 0, radius(g)));
+  for (uint r = 1; r < rings; r++)
+    for (uint s = 0; s < sectors; s++) {
+      double theta = M_PI * r / rings, phi = 2 * M_PI * s / sectors;
+      verts.push_back(vec3d(sin(theta) * cos(phi), sin(theta) * sin(phi),
+                            cos(theta)) *
+                      radius(g));
+    }
+  verts.push_back(vec3d(0, 0, -radius(g)));
+  auto ring = [&](uint r, uint s) { return 1 + (r - 1) * sectors + s % sectors; };
+  const uint south = verts.size() - 1;
+  for (uint s = 0; s < sectors; s++) {
+    faces.push_back({0, ring(1, s), ring(1, s + 1)});
+    for (uint r = 1; r + 1 < rings; r++) {
+      faces.push_back({ring(r, s), ring(r + 1, s), ring(r + 1, s + 1)});
+      faces.push_back({ring(r, s), ring(r + 1, s + 1), ring(r, s + 1)});
+    }
+    faces.push_back({ring(rings - 1, s), south, ring(rings - 1, s + 1)});
+  }
+  for (std::vector<uint> &f : faces) { // outward, seen from the origin
+    const vec3d &a = verts.at(f[0]), &b = verts.at(f[1]), &c = verts.at(f[2]);
+    vec3d n = (b - a).cross(c - a);
+    if (n.dot(a + b + c) < 0) {
+      std::swap(f[1], f[2]);
+      n = -n;
+    }
+    n.normalize();
+    normals.push_back(n);
+  }
+}
+
+// compute_randomized gives the same kernel as compute, whatever the seed,
+// with and without lazy faces and half-spaces
+static void test_randomized() {
+  for (uint mesh_seed = 0; mesh_seed < 4; mesh_seed++) {
+    std::vector<vec3d> verts, normals;
+    std::vector<std::vector<uint>> faces;
+    star_mesh(mesh_seed, verts, faces, normals);
+    for (uint mode = 0; mode < 3; mode++) {
+      auto setup = [&](PolyhedronKernel<> &K) {
+        K.lazy_faces = mode == 1;
+        K.output_half_spaces = mode == 2;
+        K.initialize(verts);
+      };
+      PolyhedronKernel<> A;
+      KernelMetrics ka;
+      setup(A);
+      A.compute(verts, faces, normals, false, &ka);
+      CHECK(ka.volume > 0);
+      for (uint seed = 0; seed < 4; seed++) {
+        PolyhedronKernel<> B;
+        KernelMetrics kb;
+        setup(B);
+        B.compute_randomized(verts, faces, normals, seed, &kb);
+        CHECK(fabs(ka.volume - kb.volume) <= 1e-9 * ka.volume);
+        CHECK(ka.centroid.dist(kb.centroid) <= 1e-9);
+        CHECK(B.kernel_faces.size() == B.kernel_face_planes.size());
+        CHECK(B.kernel_half_spaces.size() == A.kernel_half_spaces.size());
+        CHECK(B.num_unapplied == 0);
+      }
+    }
+  }
+}
+
+int main() {
+  test_randomized();
+  if (failures == 0)
+    std::cout << "All kernel tests passed" << std::endl;
+  return failures;
+}